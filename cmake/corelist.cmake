@@ -0,0 +1,40 @@
+set(core_headers
+	src/core/Catalog.h
+	src/core/ContextRules.h
+	src/core/ActorState.h
+	src/core/CallTrace.h
+	src/core/GameData.h
+	src/core/CoreUtil.h
+	src/core/FormFilter.h
+	src/core/GroupWatcher.h
+	src/core/LogCategories.h
+	src/core/MemoryUsage.h
+	src/core/OutfitPack.h
+	src/core/PerfStats.h
+	src/core/ScratchAllocator.h
+	src/core/SharedName.h
+	src/core/Validation.h
+)
+
+set(core_sources
+	src/core/Catalog.cpp
+	src/core/ContextRules.cpp
+	src/core/ActorState.cpp
+	src/core/CallTrace.cpp
+	src/core/FormFilter.cpp
+	src/core/GroupWatcher.cpp
+	src/core/LogCategories.cpp
+	src/core/MemoryUsage.cpp
+	src/core/OutfitPack.cpp
+	src/core/PerfStats.cpp
+	src/core/ScratchAllocator.cpp
+	src/core/Validation.cpp
+)
+
+set(fake_headers
+	src/core/fake/FakeGameData.h
+)
+
+set(fake_sources
+	src/core/fake/FakeGameData.cpp
+)
@@ -1,3 +1,5 @@
+include(cmake/corelist.cmake)
+
 set(headers ${headers}
 	src/PCH.h 
 	src/log.h
@@ -5,6 +7,8 @@ set(headers ${headers}
 	src/hook.h 
 	src/settings.h
 	src/OutfitPlaylist.h
+	src/SKSEGameData.h
+	${core_headers}
 )
 
 include_directories(${JSON_CPP_DIR}/include/)
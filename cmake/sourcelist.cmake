@@ -2,6 +2,8 @@ set(sources ${sources}
 	src/plugin.cpp
 	src/hook.cpp
 	src/OutfitPlaylist.cpp
+	src/SKSEGameData.cpp
+	${core_sources}
 
 	${NG_UTIL_DIR}/src/ActorUtil.cpp
 	${NG_UTIL_DIR}/src/FormUtil.cpp
@@ -1,11 +1,16 @@
 #include "OutfitPlaylist.h"
-#include "SKSEUtil/FormIDUtil.h"
-#include "SKSEUtil/MathUtil.h"
+#include "SKSEGameData.h"
+#include "core/CallTrace.h"
+#include "core/ContextRules.h"
+#include "core/CoreUtil.h"
+#include "core/LogCategories.h"
+#include "core/MemoryUsage.h"
+#include "core/OutfitPack.h"
+#include "core/PerfStats.h"
+#include "core/Validation.h"
 #include "SKSEUtil/ActorUtil.h"
-#include "SKSEUtil/StringUtil.h"
-#include "SKSEUtil/JSONUtil.h"
 #include <filesystem>
-#include <random>
+#include <memory>
 
 #include <json/json.h>
 
@@ -14,52 +19,20 @@ using namespace SKSE;
 
 namespace OutfitPlaylist
 {
-	std::vector<Outfit> sOutfits;
-	typedef std::map<std::string, OutfitGroup> OutfitGroupMap;
-	OutfitGroupMap sOutfitGroups;
-
 	const std::string OPLQuest = "oplQuestScript";
 	const std::string CustomOutfitGroupName = "CustomOutfits";
+	const std::string OutfitGroupDir = "Data/SKSE/Plugins/OutfitPlaylist";
+	const std::string DefaultTraceFile = "Data/SKSE/Plugins/OutfitPlaylist.trace";
+	const std::string DefaultValidationReportFile = "Data/SKSE/Plugins/OutfitPlaylistValidation.json";
 
-	typedef std::map<FormID, Outfit> ActorOutfitMap;
-	ActorOutfitMap sActorEquippedOutfits;
-
-	std::set<RE::FormID> sIgnoredFormIDs;
-
-	IndexVec sShuffledIndices;
-	unsigned int sShuffledSeed = 0u;
-
-	const unsigned int SAVE_VERSION = 1u;
-
-	inline const auto OutfitPlaylistRecord = _byteswap_ulong('OPLE');
-
-	Outfit::Outfit()
-		: doNotRemove(false) {}
-
-	//Util
-	template <class FormT>
-	bool LookupForm(RE::FormID form_id, const std::string& mod_name, FormT*& out)
-	{
-		TESForm* res = TESDataHandler::GetSingleton()->LookupForm(form_id, mod_name);
-		if (res) {
-			out = res->As<FormT>();
-			std::string name = res->GetName();
-			if (name.empty())
-				name = res->GetFormEditorID();
-			//log::info("Retrieved form: {} {} {}", mod_name, SKSEUtil::hexToString(form_id), name);
-			return true;
-		} else {
-			//log::error("Form Retrieval failed: {} {}", mod_name, SKSEUtil::hexToString(form_id));
-			return false;
-		}
-	}
+	SKSEFormResolver sSKSEFormResolver;
 
 	//Plugin
 	void LoadPluginData()
 	{
-		sActorEquippedOutfits.clear();
-		sShuffledIndices.clear();
-		sShuffledSeed = 0u;
+		PerfTimer timer(kPerfLoadPluginData);
+
+		clearActorState();
 
 		//Load config
 		Json::Reader reader;
@@ -67,326 +40,94 @@ namespace OutfitPlaylist
 		Json::Value config_json;
 		reader.parse(config_file, config_json);
 
-		sIgnoredFormIDs.clear();
-		Json::Value ignored_forms_json = config_json["ignoredForms"];
-		for (Json::Value::iterator it = ignored_forms_json.begin(); it != ignored_forms_json.end(); ++it) {
-			RE::FormID local_form_id;
-			std::string mod_name;
-			if (SKSEUtil::deserializeFormID(*it, local_form_id, mod_name)) {
-				RE::TESForm* form = TESDataHandler::GetSingleton()->LookupForm(local_form_id, mod_name);
-				if (form)
-					sIgnoredFormIDs.insert(form->formID);
-			}
-		}
-
-		log::info("Loaded {} ignored form ids", sIgnoredFormIDs.size());
+		SetFormResolver(&sSKSEFormResolver);
 
-		//Load Outfits
-		sOutfits.clear();
-		sOutfitGroups.clear();
-		sOutfits.reserve(1024);
-
-		std::string outfit_json_dir = "Data/SKSE/Plugins/OutfitPlaylist";
-		for (const auto& entry : std::filesystem::directory_iterator(outfit_json_dir)) {
-			std::string path = entry.path().string();
-			if (!path.ends_with(".json"))
-				continue;
-
-			log::info("Reading outfit group file {}", path);
-			std::ifstream group_file(path);
-
-			Json::Value group_json;
-			reader.parse(group_file, group_json);
-
-			Json::Value outfits_json = group_json["outfits"];
-			if (!outfits_json.isObject()) {
-				log::error("Invalid group file JSON {}", path);
-				continue;
-			}
-
-			std::string group_name = entry.path().filename().replace_extension("").string();
-			OutfitGroup& group = sOutfitGroups.insert(std::pair<std::string, OutfitGroup>(group_name, OutfitGroup())).first->second;
-			group.name = group_name;
-			group.outfitIndices.reserve(outfits_json.size());
-
-			for (Json::Value::iterator it = outfits_json.begin(); it != outfits_json.end(); ++it) {
-				if (!it->isArray()) {
-					log::error("Invalid outfit JSON {}", it.key().asString());
-					continue;
-				}
-
-				unsigned int outfit_index = sOutfits.size();
-				sOutfits.push_back(Outfit());
-				Outfit& outfit = sOutfits[outfit_index];
-				outfit.name = it.key().asString();
-				outfit.groupName = group.name;
-				outfit.forms.reserve(it->size());
-
-				for (unsigned int i = 0u; i < it->size(); i++) {
-					FormID form_id;
-					std::string mod_name;
-					if (SKSEUtil::deserializeFormID((*it)[i], form_id, mod_name)) {
-						TESForm* form = NULL;
-						if (!LookupForm(form_id, mod_name, form) || !form) {
-							log::error("Outfit form not found: {}:{}", outfit.name, (*it)[i].asString());
-							continue;
-						}
-
-						if (form->formType != FormType::Armor && form->formType != FormType::Weapon && form->formType != FormType::Ammo && form->formType != FormType::Light)
-						{
-							log::error("Outfit form is the wrong type: {}:{}", outfit.name, (*it)[i].asString());
-							continue;
-						}
-
-						outfit.forms.push_back(form);
-					}
-					else {
-						log::error("Invalid outfit formID: {}:{}", outfit.name, (*it)[i].asString());
-					}
-				}
+		//Opt-in report of every problem in the group files, "validateOnly" skips loading the catalog
+		bool validate_only = config_json["validateOnly"].asBool();
+		if (config_json["validateGroupFiles"].asBool() || validate_only) {
+			Json::Value report_json;
+			ValidateGroupFiles(OutfitGroupDir, report_json);
+			writeValidationReport(config_json["validationReportFile"].isString() ? config_json["validationReportFile"].asString() : DefaultValidationReportFile, report_json);
+		}
 
-				group.outfitIndices.push_back(outfit_index);
-			}
+		if (validate_only) {
+			//An empty catalog rather than the last one, so the cleared actor state matches it
+			spdlog::warn("validateOnly is set, no outfits are loaded and Outfit Playlist does nothing until it is turned off");
+			ClearCatalog();
 		}
+		else {
+			//Opt-in conversion of the group files into one outfit pack, read back on the next load
+			if (config_json["exportOutfitPack"].isString())
+				ExportOutfitPack(OutfitGroupDir, config_json["exportOutfitPack"].asString());
 
-		log::info("Loaded {} outfits in {} groups", sOutfits.size(), sOutfitGroups.size());
+			LoadCatalog(OutfitGroupDir, config_json);
+		}
+		configureActorPruning(config_json);
+
+		//Opt-in hot reload of group files, applied on the game thread
+		if (config_json["watchGroupFiles"].asBool() && !validate_only) {
+			int interval_ms = config_json["watchIntervalMs"].isInt() ? config_json["watchIntervalMs"].asInt() : 2000;
+			StartGroupWatcher(OutfitGroupDir, std::chrono::milliseconds(std::max(interval_ms, 100)), []() {
+				SKSE::GetTaskInterface()->AddTask([]() {
+					GroupFileChanges changes;
+					if (takeGroupFileChanges(changes))
+						ReloadGroupFiles(changes);
+				});
+			});
+		}
+		else
+			StopGroupWatcher();
+
+		//Opt-in native call trace for offline replay
+		if (config_json["traceNatives"].asBool())
+			StartCallTrace(config_json["traceFile"].isString() ? config_json["traceFile"].asString() : DefaultTraceFile);
+		else
+			StopCallTrace();
 	}
 
 	void OnGameLoaded(SKSE::SerializationInterface* serde)
 	{
+		PerfTimer timer(kPerfGameLoaded);
 		LoadPluginData();
 
 		//Load saved equipped outfits
-		std::uint32_t type;
-		std::uint32_t size;
-		std::uint32_t version;
-		while (serde->GetNextRecordInfo(type, version, size))
-		{
-			if (type == OutfitPlaylistRecord) {
-
-				Json::Value save_json;
-				if (SKSEUtil::deserializeJsonFromRecord(serde, save_json) && save_json.isObject()) {
-					/*
-					Json::StyledWriter writer;
-					log::info("{}", writer.write(save_json));
-					*/
-
-					log::info("Reading saved actor outfits");
-
-					Json::Value& actor_outfits_json = save_json["actorOutfits"];
-					for (Json::ValueIterator it = actor_outfits_json.begin(); it != actor_outfits_json.end(); ++it)
-					{
-						RE::FormID actor_form_id = SKSEUtil::stringToHex(it.key().asCString());
-						if (serde) {
-							if (!serde->ResolveFormID(actor_form_id, actor_form_id)) {
-								log::error("Failed to resolve actor FormID {:X}", actor_form_id);
-								continue;
-							}
-						}
-
-						RE::Actor* actor = RE::TESForm::LookupByID<RE::Actor>(actor_form_id);
-						if (!actor) {
-							log::error("Actor not found {:X}", actor_form_id);
-							continue;
-						}
-
-						Outfit outfit;
-						SKSEUtil::tryGetString((*it)["name"], outfit.name);
-						SKSEUtil::tryGetString((*it)["group"], outfit.groupName);
-						SKSEUtil::tryGetBool((*it)["doNotRemove"], outfit.doNotRemove);
-						Json::Value& forms_json = (*it)["forms"];
-
-						for (unsigned int i = 0u; i < forms_json.size(); i++) {
-							RE::FormID form_id = forms_json[i].asUInt();
-							if (!serde->ResolveFormID(form_id, form_id)) {
-								log::error("Failed to resolve FormID {:X}", form_id);
-								continue;
-							}
-
-							TESForm* form = TESForm::LookupByID<TESForm>(form_id);
-							if (form) {
-								//log::info("Outfit form {}", form->GetName());
-								outfit.forms.push_back(form);
-							}
-							else
-								log::error("Outfit form not found {:X}", form_id);
-						}
-
-						if (actor && !outfit.name.empty() && !outfit.groupName.empty()) {
-							sActorEquippedOutfits[actor->formID] = outfit;
-							log::info("Loaded outfit for {}", actor->GetActorBase()->GetName());
-						}
-						else {
-							log::warn("Invalid outfit save for {}", actor->GetActorBase()->GetName());
-						}
-					}
-				}
-				else
-					log::info("No save JSON");
-			}
-		}
+		SKSERecordSerializer record_serializer(serde);
+		loadActorState(record_serializer);
 	}
 
 	void OnGameSaved(SKSE::SerializationInterface* serde)
 	{
-		if (sActorEquippedOutfits.empty())
-			return;
+		logPerfSummary();
+		logMemorySummary();
+		flushCallTrace();
 
-		if (!serde->OpenRecord(OutfitPlaylistRecord, SAVE_VERSION)) {
-			log::error("Unable to open record to write cosave data.");
-			return;
-		}
-
-		log::info("Saving actor outfits");
-
-		Json::Value save_json;
-		Json::Value& actor_outfits_json = save_json["actorOutfits"];
-		for (ActorOutfitMap::iterator it = sActorEquippedOutfits.begin(); it != sActorEquippedOutfits.end(); ++it)
-		{
-			RE::Actor* actor = RE::TESForm::LookupByID<RE::Actor>(it->first);
-			if (!actor)
-				continue;
-
-			Json::Value& actor_outfit_json = actor_outfits_json[SKSEUtil::hexToString(it->first)];
-			actor_outfit_json["name"] = it->second.name;
-			actor_outfit_json["group"] = it->second.groupName;
-			actor_outfit_json["doNotRemove"] = it->second.doNotRemove;
-
-			if (!it->second.forms.empty()) {
-				Json::Value& forms_json = actor_outfit_json["forms"];
-				for (std::size_t i = 0u; i < it->second.forms.size(); i++)
-					forms_json.append(it->second.forms[i]->formID);
-			}
-
-			log::info("Saved outfit for {}", actor->GetActorBase()->GetName());
-		}
-
-		SKSEUtil::serializeJsonToRecord(serde, save_json);
+		PerfTimer timer(kPerfGameSaved);
+		SKSERecordSerializer record_serializer(serde);
+		saveActorState(record_serializer);
 	}
 
 	//Outfits
 
-	Outfit* setOutfit(Actor* actor, unsigned int index, bool do_not_remove)
+	bool setOutfit(Actor* actor, unsigned int index, bool do_not_remove, NativeFormArray* forms_out)
 	{
 		if (!actor)
-			return NULL;
-
-		if (index < sOutfits.size()) {
-			Outfit& outfit = sOutfits[index];
-			
-			log::info("Setting actor {} outfit to {}", actor->GetName(), outfit.name);
-
-			sActorEquippedOutfits[actor->formID] = outfit;
-			sActorEquippedOutfits[actor->formID].doNotRemove = do_not_remove;
-			return &outfit;
-		}
-
-		return NULL;
+			return false;
+		return setActorOutfit(actor->formID, index, do_not_remove, forms_out);
 	}
 
-	void clearOutfit(Actor* actor, FormVec* forms_out)
+	void clearOutfit(Actor* actor, NativeFormArray* forms_out)
 	{
 		if (!actor)
 			return;
-
-		log::info("Removing existing outfit");
-		ActorOutfitMap::iterator it = sActorEquippedOutfits.find(actor->formID);
-		if (it != sActorEquippedOutfits.end()) {
-			if (forms_out) {
-				forms_out->clear();
-				if (it->second.doNotRemove) {
-					forms_out->reserve(it->second.forms.size() + 1);
-					forms_out->push_back(NULL);
-				}
-				else
-					forms_out->reserve(it->second.forms.size());
-
-				for (std::size_t i = 0u; i < it->second.forms.size(); i++)
-					forms_out->push_back(it->second.forms[i]);
-			}
-
-			sActorEquippedOutfits.erase(it);
-		}
-	}
-
-	bool shuffleOutfits(unsigned int seed) {
-		if (sShuffledSeed == seed && !sShuffledIndices.empty())
-			return false;
-
-		log::info("Shuffling outfits with seed {}", seed);
-
-		std::mt19937 engine;
-		engine.seed(seed);
-		sShuffledIndices.clear();
-		sShuffledIndices.reserve(sOutfits.size());
-
-		IndexVec remaining_indices;
-		remaining_indices.resize(sOutfits.size());
-		for (unsigned int i = 0u; i < sOutfits.size(); i++)
-			remaining_indices[i] = i;
-
-		while (!remaining_indices.empty()) {
-			unsigned int i = engine() % remaining_indices.size();
-			sShuffledIndices.push_back(remaining_indices[i]);
-			log::info("{}", remaining_indices[i]);
-
-			if (remaining_indices.size() > 1u)
-				remaining_indices[i] = remaining_indices[remaining_indices.size() - 1];
-			remaining_indices.pop_back();
-		}
-
-		sShuffledSeed = seed;
-
-		return true;
-	}
-
-	void serializeOutfitGroup(OutfitGroup& group, Json::Value& json_value) {
-		json_value["outfits"] = Json::Value(Json::objectValue);
-		Json::Value& outfit_dict = json_value["outfits"];
-
-		for (unsigned int i = 0u; i < group.outfitIndices.size(); i++)
-		{
-			Outfit& outfit = sOutfits[group.outfitIndices[i]];
-			std::string name = outfit.name;
-
-			//Use a discriminator to make sure the outfit name is unique
-			int discriminator = 0;
-			while (outfit_dict.isMember(name)) {
-				discriminator++;
-				std::ostringstream string_stream;
-				string_stream << outfit.name << '.' << std::setfill('0') << std::setw(3) << discriminator;
-				name = string_stream.str();
-			}
-
-			outfit_dict[name] = Json::Value(Json::arrayValue);
-
-			Json::Value& forms_list = outfit_dict[name];
-			for (unsigned k = 0u; k < outfit.forms.size(); k++) {
-				Json::Value form_id_json;
-				SKSEUtil::serializeFormID(outfit.forms[k]->formID, form_id_json);
-				forms_list.append(form_id_json);
-			}
-		}
-	}
-
-	void saveGroupFile(OutfitGroup& group) {
-		Json::Value group_json;
-		serializeOutfitGroup(group, group_json);
-
-		std::string group_file_path = "Data/SKSE/Plugins/OutfitPlaylist/";
-		group_file_path.append(group.name);
-		group_file_path.append(".json");
-
-		std::ofstream group_file(group_file_path);
-
-		Json::StyledStreamWriter writer;
-		writer.write(group_file, group_json);
+		clearActorOutfit(actor->formID, forms_out);
 	}
 
 	bool generateOutfitFromWorn(Actor* actor, Outfit& outfit_out, bool apparel_only) {
 		if (!actor)
 			return false;
 
+		CatalogPtr catalog = getCatalog();
+
 		SKSEUtil::FormSet worn_forms;
 		SKSEUtil::GetWornForms(actor, &worn_forms);
 
@@ -398,7 +139,7 @@ namespace OutfitPlaylist
 				continue;
 
 			//Ignore non-playable or ignored items
-			if ((form->GetFormFlags() & 4) > 0 || sIgnoredFormIDs.contains(form->formID))
+			if ((form->GetFormFlags() & 4) > 0 || catalog->ignoredFormIDs.contains(form->formID))
 				continue;
 
 			TESObjectARMO* armor = form->As<TESObjectARMO>();
@@ -419,172 +160,363 @@ namespace OutfitPlaylist
 		return true;
 	}
 
-	int getOutfitIndex(const std::string& group_name, const std::string& outfit_name) {
-		OutfitGroupMap::iterator it = sOutfitGroups.find(group_name);
-		if (it != sOutfitGroups.end()) {
-			//Case-sensitive
-			for (unsigned int i = 0u; i < it->second.outfitIndices.size(); i++) {
-				if (sOutfits[it->second.outfitIndices[i]].name == outfit_name)
-					return static_cast<int>(it->second.outfitIndices[i]);
-			}
+	//Context keys
 
-			//Non case-sensitive search because Skyrim messes with string casing
-			for (unsigned int i = 0u; i < it->second.outfitIndices.size(); i++) {
-				if (SKSEUtil::nonCaseSensitiveEquals(outfit_name, sOutfits[it->second.outfitIndices[i]].name))
-					return static_cast<int>(it->second.outfitIndices[i]);
-			}
-		}
-		return -1;
+	unsigned int getContextTime()
+	{
+		float hour = RE::Calendar::GetSingleton()->GetHour();
+		if (hour >= 5.0f && hour < 10.0f)
+			return kTimeMorning;
+		if (hour >= 10.0f && hour < 17.0f)
+			return kTimeDay;
+		if (hour >= 17.0f && hour < 21.0f)
+			return kTimeEvening;
+		return kTimeNight;
 	}
 
-	Outfit* getActorEquippedOutfit(Actor* actor) {
-		if (!actor)
-			return NULL;
-
-		ActorOutfitMap::iterator it = sActorEquippedOutfits.find(actor->formID);
-		if (it != sActorEquippedOutfits.end()) {
-			return &it->second;
-		}
-		
-		return NULL;
+	unsigned int getContextWeather()
+	{
+		RE::Sky* sky = RE::Sky::GetSingleton();
+		if (!sky || !sky->currentWeather)
+			return kWeatherClear;
+
+		const auto& flags = sky->currentWeather->data.flags;
+		if (flags.any(TESWeather::WeatherDataFlag::kSnow))
+			return kWeatherSnow;
+		if (flags.any(TESWeather::WeatherDataFlag::kRainy))
+			return kWeatherRain;
+		if (flags.any(TESWeather::WeatherDataFlag::kCloudy))
+			return kWeatherCloudy;
+		return kWeatherClear;
 	}
 
-	std::string makeNameUniqueForGroup(OutfitGroup& group, const std::string& name, const std::string& ignore_name = std::string())
+	unsigned int getContextKey(const OutfitCatalog& catalog, Actor* actor)
 	{
-		std::set<std::string> group_names;
-		for (unsigned int i = 0u; i < group.outfitIndices.size(); i++) {
-			if (sOutfits[group.outfitIndices[i]].name != ignore_name) {
-				group_names.insert(SKSEUtil::toLowercaseString(sOutfits[group.outfitIndices[i]].name));
+		unsigned int key = 0u;
+
+		TESObjectCELL* cell = actor->GetParentCell();
+		if (cell && cell->IsInteriorCell())
+			key |= 0x1u;
+		if (actor->IsInCombat())
+			key |= 0x2u;
+		key |= getContextTime() << 2;
+		key |= getContextWeather() << 4;
+
+		//The first configured keyword found on the location decides the slot
+		BGSLocation* location = actor->GetCurrentLocation();
+		if (location) {
+			const std::vector<std::string>& keywords = catalog.contextRules->locationKeywords;
+			for (unsigned int i = 0u; i < keywords.size(); i++) {
+				if (location->HasKeywordString(keywords[i])) {
+					key += (i + 1u) * CONTEXT_BASE_COUNT;
+					break;
+				}
 			}
 		}
 
-		//Use a discriminator to make sure the outfit name is unique
-		std::string unique_name = name;
-		int discriminator = 0;
-		while (group_names.contains(SKSEUtil::toLowercaseString(unique_name))) {
-			discriminator++;
-			std::ostringstream string_stream;
-			string_stream << name << '.' << std::setfill('0') << std::setw(3) << discriminator;
-			unique_name = string_stream.str();
-		}
-
-		return unique_name;
+		return key;
 	}
 
-	bool outfitFormsAreTheSame(Outfit& outfit1, Outfit& outfit2) {
-		if (outfit1.forms.size() != outfit2.forms.size())
-			return false;
+	//Returns the context key for the actor, or -1 if no rule bucket applies
+	int getContextBucketKey(const OutfitCatalog& catalog, Actor* actor)
+	{
+		if (!actor || !catalog.contextBuckets)
+			return -1;
 
-		for (unsigned int i = 0u; i < outfit1.forms.size(); i++) {
-			bool found = false;
-			for (unsigned int k = 0u; k < outfit2.forms.size(); k++) {
-				if (outfit2.forms[k] == outfit1.forms[i]) {
-					found = true;
-					break;
-				}
-			}
-			if (!found)
-				return false;
-		}
+		unsigned int key = getContextKey(catalog, actor);
+		if (key >= catalog.contextBuckets->buckets.size())
+			return -1;
+		return static_cast<int>(key);
+	}
 
-		return true;
+	//Copies the outfit out, the shard entry can change as soon as the lock is released
+	bool getActorEquippedOutfit(Actor* actor, Outfit& outfit_out) {
+		if (!actor)
+			return false;
+		return getActorOutfit(actor->formID, outfit_out);
 	}
 
 	//Papyrus
 
+	TraceForm traceActor(Actor* actor)
+	{
+		return TraceForm(actor ? actor->formID : 0u);
+	}
+
 	int PapyrusGetNumOutfits(RE::StaticFunctionTag*) {
-		return static_cast<int>(sOutfits.size());
+		PerfTimer timer(kPerfGetNumOutfits);
+		TracedCall trace(kPerfGetNumOutfits);
+
+		return static_cast<int>(getCatalog()->outfits.size());
 	}
 
-	std::vector<TESForm*> PapyrusGetOutfitForms(RE::StaticFunctionTag*, int index)
+	//Form lists are returned in the calling thread's scratch block, the VM copies them into its array
+	NativeFormArray PapyrusGetOutfitForms(RE::StaticFunctionTag*, int index)
 	{
-		if (index < sOutfits.size())
-			return sOutfits[index].forms;
-		return std::vector<TESForm*>();
+		PerfTimer timer(kPerfGetOutfitForms);
+		TracedCall trace(kPerfGetOutfitForms, index);
+
+		CatalogPtr catalog = materializeOutfit(index);
+		if (index < catalog->outfits.size()) {
+			const FormVec& forms = catalog->outfits[index].forms;
+			return NativeFormArray(forms.begin(), forms.end());
+		}
+		return NativeFormArray();
 	}
 
 	std::string PapyrusGetOutfitGroupName(RE::StaticFunctionTag*, int index)
 	{
-		if (index < sOutfits.size())
-			return sOutfits[index].groupName;
+		PerfTimer timer(kPerfGetOutfitGroupName);
+		TracedCall trace(kPerfGetOutfitGroupName, index);
+
+		CatalogPtr catalog = getCatalog();
+		if (index < catalog->outfits.size())
+			return catalog->outfits[index].groupName;
 		return std::string();
 	}
 
 	std::string PapyrusGetOutfitName(RE::StaticFunctionTag*, int index)
 	{
-		if (index < sOutfits.size())
-			return sOutfits[index].name;
+		PerfTimer timer(kPerfGetOutfitName);
+		TracedCall trace(kPerfGetOutfitName, index);
+
+		CatalogPtr catalog = getCatalog();
+		if (index < catalog->outfits.size())
+			return catalog->outfits[index].name;
 		return std::string();
 	}
 
 	int PapyrusGetOutfitIndex(RE::StaticFunctionTag*, std::string group_name, std::string outfit_name)
 	{
-		return getOutfitIndex(group_name, outfit_name);
+		PerfTimer timer(kPerfGetOutfitIndex);
+		TracedCall trace(kPerfGetOutfitIndex, group_name, outfit_name);
+
+		return getOutfitIndex(*getCatalog(), group_name, outfit_name);
 	}
 
-	std::vector<TESForm*> PapyrusSetOutfit(RE::StaticFunctionTag*, Actor* actor, int index)
+	std::string PapyrusGetOutfitID(RE::StaticFunctionTag*, int index)
 	{
-		Outfit* outfit = setOutfit(actor, index);
-		if (outfit)
-			return outfit->forms;
-		return std::vector<TESForm*>();
+		PerfTimer timer(kPerfGetOutfitID);
+		TracedCall trace(kPerfGetOutfitID, index);
+
+		CatalogPtr catalog = getCatalog();
+		if (index >= 0 && index < catalog->outfits.size() && !catalog->outfits[index].groupName.empty())
+			return outfitIDToString(catalog->outfits[index].id);
+		return std::string();
+	}
+
+	int PapyrusGetOutfitIndexByID(RE::StaticFunctionTag*, std::string outfit_id)
+	{
+		PerfTimer timer(kPerfGetOutfitIndexByID);
+		TracedCall trace(kPerfGetOutfitIndexByID, outfit_id);
+
+		return getOutfitIndexByID(*getCatalog(), stringToOutfitID(outfit_id));
+	}
+
+	NativeFormArray PapyrusSetOutfit(RE::StaticFunctionTag*, Actor* actor, int index)
+	{
+		PerfTimer timer(kPerfSetOutfit);
+		TracedCall trace(kPerfSetOutfit, traceActor(actor), index);
+
+		NativeFormArray forms;
+		setOutfit(actor, index, false, &forms);
+		return forms;
 	}
 
-	std::vector<TESForm*> PapyrusClearOutfit(RE::StaticFunctionTag*, Actor* actor)
+	NativeFormArray PapyrusSetOutfitByID(RE::StaticFunctionTag*, Actor* actor, std::string outfit_id)
 	{
-		FormVec forms;
+		PerfTimer timer(kPerfSetOutfitByID);
+		TracedCall trace(kPerfSetOutfitByID, traceActor(actor), outfit_id);
+
+		NativeFormArray forms;
+		int index = getOutfitIndexByID(*getCatalog(), stringToOutfitID(outfit_id));
+		if (index >= 0)
+			setOutfit(actor, index, false, &forms);
+		return forms;
+	}
+
+	NativeFormArray PapyrusClearOutfit(RE::StaticFunctionTag*, Actor* actor)
+	{
+		PerfTimer timer(kPerfClearOutfit);
+		TracedCall trace(kPerfClearOutfit, traceActor(actor));
+
+		NativeFormArray forms;
 		clearOutfit(actor, &forms);
 		return forms;
 	}
 
 	std::string PapyrusGetActorOutfitGroupName(RE::StaticFunctionTag*, Actor* actor)
 	{
-		Outfit* outfit = getActorEquippedOutfit(actor);
-		if (outfit)
-			return outfit->groupName;
+		PerfTimer timer(kPerfGetActorOutfitGroupName);
+		TracedCall trace(kPerfGetActorOutfitGroupName, traceActor(actor));
+
+		ActorOutfitInfo info;
+		if (actor && getActorOutfitInfo(actor->formID, info))
+			return info.groupName;
 		return std::string();
 	}
 
 	std::string PapyrusGetActorOutfitName(RE::StaticFunctionTag*, Actor* actor)
 	{
-		Outfit* outfit = getActorEquippedOutfit(actor);
-		if (outfit)
-			return outfit->name;
+		PerfTimer timer(kPerfGetActorOutfitName);
+		TracedCall trace(kPerfGetActorOutfitName, traceActor(actor));
+
+		ActorOutfitInfo info;
+		if (actor && getActorOutfitInfo(actor->formID, info))
+			return info.name;
 		return std::string();
 	}
 
-	int PapyrusGetShuffledOutfitIndex(RE::StaticFunctionTag*, int shuffle_index, int seed)
+	//[name, group, catalog index, doNotRemove], empty without an outfit. The index is -1 once the
+	//outfit left the catalog, doNotRemove is "1" or "" so it casts to Bool.
+	std::vector<std::string> PapyrusGetActorOutfitInfo(RE::StaticFunctionTag*, Actor* actor)
 	{
-		if (seed < 0)
-			return shuffle_index % static_cast<int>(sOutfits.size());
-		else {
-			shuffleOutfits(seed);
-			if (!sShuffledIndices.empty())
-				return static_cast<int>(sShuffledIndices[shuffle_index % sShuffledIndices.size()]);
+		PerfTimer timer(kPerfGetActorOutfitInfo);
+		TracedCall trace(kPerfGetActorOutfitInfo, traceActor(actor));
+
+		std::vector<std::string> result;
+		ActorOutfitInfo info;
+		if (actor && getActorOutfitInfo(actor->formID, info)) {
+			result.reserve(4u);
+			result.push_back(info.name);
+			result.push_back(info.groupName);
+			result.push_back(std::to_string(info.index));
+			result.push_back(info.doNotRemove ? "1" : "");
 		}
+		return result;
+	}
 
-		return 0;
+	int PapyrusGetShuffledOutfitIndex(RE::StaticFunctionTag*, int shuffle_index, int seed)
+	{
+		PerfTimer timer(kPerfGetShuffledOutfitIndex);
+		TracedCall trace(kPerfGetShuffledOutfitIndex, shuffle_index, seed);
+
+		return getShuffledOutfitIndex(*getCatalog(), shuffle_index, seed);
 	}
 
 	int PapyrusGetOutfitShuffleIndex(RE::StaticFunctionTag*, int index, int seed)
 	{
+		PerfTimer timer(kPerfGetOutfitShuffleIndex);
+		TracedCall trace(kPerfGetOutfitShuffleIndex, index, seed);
+
+		return getOutfitShuffleIndex(*getCatalog(), index, seed);
+	}
+
+	int PapyrusGetNumContextOutfits(RE::StaticFunctionTag*, Actor* actor)
+	{
+		PerfTimer timer(kPerfGetNumContextOutfits);
+		TracedCall trace(kPerfGetNumContextOutfits, traceActor(actor));
+
+		CatalogPtr catalog = getCatalog();
+		int key = getContextBucketKey(*catalog, actor);
+		if (key >= 0)
+			return static_cast<int>(catalog->contextBuckets->buckets[key]->size());
+		return 0;
+	}
+
+	int PapyrusGetContextOutfitIndex(RE::StaticFunctionTag*, Actor* actor, int shuffle_index, int seed)
+	{
+		PerfTimer timer(kPerfGetContextOutfitIndex);
+		TracedCall trace(kPerfGetContextOutfitIndex, traceActor(actor), shuffle_index, seed);
+
+		CatalogPtr catalog = getCatalog();
+		int key = getContextBucketKey(*catalog, actor);
+		if (key < 0 || catalog->contextBuckets->buckets[key]->empty() || shuffle_index < 0)
+			return -1;
+
+		const IndexVec& bucket = *catalog->contextBuckets->buckets[key];
+		unsigned int position = static_cast<unsigned int>(shuffle_index) % bucket.size();
 		if (seed < 0)
-			return index;
+			return static_cast<int>(bucket[position]);
 
-		if (index < 0 || index > sOutfits.size())
-			return 0;
+		//Context keys start with a letter so they never collide with group playlist keys
+		std::string cache_key = "c" + std::to_string(key) + "|" + std::to_string(seed);
+		PlaylistPtr playlist = getCachedPlaylist(*catalog, cache_key, bucket, seed);
+		return static_cast<int>(playlist->outfitIndices[position]);
+	}
 
-		shuffleOutfits(seed);
-		for (unsigned int i = 0u; i < sShuffledIndices.size(); i++) {
-			if (sShuffledIndices[i] == static_cast<unsigned int>(index))
-				return i;
-		}
+	int PapyrusGetGroupPlaylistSize(RE::StaticFunctionTag*, std::vector<std::string> group_names)
+	{
+		PerfTimer timer(kPerfGetGroupPlaylistSize);
+		TracedCall trace(kPerfGetGroupPlaylistSize, group_names);
+
+		PlaylistPtr playlist = getGroupPlaylist(*getCatalog(), group_names, -1);
+		return static_cast<int>(playlist->outfitIndices.size());
+	}
+
+	int PapyrusGetGroupShuffledOutfitIndex(RE::StaticFunctionTag*, std::vector<std::string> group_names, int shuffle_index, int seed)
+	{
+		PerfTimer timer(kPerfGetGroupShuffledOutfitIndex);
+		TracedCall trace(kPerfGetGroupShuffledOutfitIndex, group_names, shuffle_index, seed);
+
+		return getGroupShuffledOutfitIndex(*getCatalog(), group_names, shuffle_index, seed);
+	}
+
+	int PapyrusGetGroupOutfitShuffleIndex(RE::StaticFunctionTag*, std::vector<std::string> group_names, int index, int seed)
+	{
+		PerfTimer timer(kPerfGetGroupOutfitShuffleIndex);
+		TracedCall trace(kPerfGetGroupOutfitShuffleIndex, group_names, index, seed);
+
+		return getGroupOutfitShuffleIndex(*getCatalog(), group_names, index, seed);
+	}
 
+	int PapyrusGetNonRepeatingOutfitIndex(RE::StaticFunctionTag*, Actor* actor, std::vector<std::string> group_names, int shuffle_index, int seed)
+	{
+		PerfTimer timer(kPerfGetNonRepeatingOutfitIndex);
+		TracedCall trace(kPerfGetNonRepeatingOutfitIndex, traceActor(actor), group_names, shuffle_index, seed);
+
+		if (!actor)
+			return -1;
+
+		return getNonRepeatingOutfitIndex(*getCatalog(), actor->formID, group_names, shuffle_index, seed);
+	}
+
+	void PapyrusClearOutfitHistory(RE::StaticFunctionTag*, Actor* actor)
+	{
+		PerfTimer timer(kPerfClearOutfitHistory);
+		TracedCall trace(kPerfClearOutfitHistory, traceActor(actor));
+
+		if (!actor)
+			return;
+
+		clearActorHistory(actor->formID);
+	}
+
+	float PapyrusGetOutfitWeight(RE::StaticFunctionTag*, int index)
+	{
+		PerfTimer timer(kPerfGetOutfitWeight);
+		TracedCall trace(kPerfGetOutfitWeight, index);
+
+		CatalogPtr catalog = getCatalog();
+		if (index >= 0 && index < catalog->outfits.size())
+			return catalog->outfits[index].weight;
+		return 0.0f;
+	}
+
+	int PapyrusGetOutfitSlotMask(RE::StaticFunctionTag*, int index)
+	{
+		PerfTimer timer(kPerfGetOutfitSlotMask);
+		TracedCall trace(kPerfGetOutfitSlotMask, index);
+
+		CatalogPtr catalog = materializeOutfit(index);
+		if (index >= 0 && index < catalog->outfits.size())
+			return static_cast<int>(catalog->outfits[index].slotMask);
 		return 0;
 	}
 
+	int PapyrusGetWeightedOutfitIndex(RE::StaticFunctionTag*, std::string group_name, int draw_index, int seed)
+	{
+		PerfTimer timer(kPerfGetWeightedOutfitIndex);
+		TracedCall trace(kPerfGetWeightedOutfitIndex, group_name, draw_index, seed);
+
+		return getWeightedOutfitIndex(*getCatalog(), group_name, draw_index, seed);
+	}
+
 	bool PapyrusRegisterCurrentOutfit(RE::StaticFunctionTag*, Actor* actor, std::string group_name, std::string outfit_name, bool apparel_only)
 	{
+		PerfTimer timer(kPerfRegisterCurrentOutfit);
+		TracedCall trace(kPerfRegisterCurrentOutfit, traceActor(actor), group_name, outfit_name, apparel_only);
+
 		Outfit outfit;
 		if (!generateOutfitFromWorn(actor, outfit, apparel_only))
 			return false;
@@ -592,53 +524,32 @@ namespace OutfitPlaylist
 		if (!outfit_name.empty())
 			outfit.name = outfit_name;
 
-		//Get/add the custom outfit group
-		OutfitGroupMap::iterator group_it = sOutfitGroups.find(group_name);
-		if (group_it == sOutfitGroups.end()) {
-			group_it = sOutfitGroups.insert(std::pair<std::string, OutfitGroup>(group_name, OutfitGroup())).first;
-			group_it->second.name = group_name;
-		}
+		unsigned int outfit_index;
+		if (!registerOutfit(outfit, group_name, outfit_index))
+			return false; //Outfit already exists in the group
 
-		//Check if the outfit already exists in the group
-		for (unsigned int i = 0u; i < group_it->second.outfitIndices.size(); i++) {
-			Outfit& existing = sOutfits[group_it->second.outfitIndices[i]];
-			if (outfitFormsAreTheSame(outfit, existing))
-				return false;
-		}
-
-		//Add a new outfit and assign it to the group
-		unsigned int outfit_index = sOutfits.size();
-		outfit.name = makeNameUniqueForGroup(group_it->second, outfit.name);
-		outfit.groupName = group_it->second.name;
-		sOutfits.push_back(outfit);
-		group_it->second.outfitIndices.push_back(outfit_index);
-
-		saveGroupFile(group_it->second); //Save the group file
 		setOutfit(actor, outfit_index, true); //Update the actor outfit
 
 		return true;
 	}
-	
+
 	bool PapyrusReplaceCurrentOutfit(RE::StaticFunctionTag*, Actor* actor, bool apparel_only) {
+		PerfTimer timer(kPerfReplaceCurrentOutfit);
+		TracedCall trace(kPerfReplaceCurrentOutfit, traceActor(actor), apparel_only);
+
 		Outfit outfit;
 		if (!generateOutfitFromWorn(actor, outfit, apparel_only))
 			return false;
 
 		//Get current outfit for the actor
-		Outfit* equipped_outfit = getActorEquippedOutfit(actor);
-		if (!equipped_outfit)
+		Outfit equipped_outfit;
+		if (!getActorEquippedOutfit(actor, equipped_outfit))
 			return false; //No current outfit
 
-		OutfitGroupMap::iterator group_it = sOutfitGroups.find(equipped_outfit->groupName);
-		if (group_it == sOutfitGroups.end())
-			return false; //Group not found
-
-		int outfit_index = getOutfitIndex(equipped_outfit->groupName, equipped_outfit->name);
-		if (outfit_index < 0 || outfit_index >= sOutfits.size())
+		int outfit_index = replaceOutfitForms(equipped_outfit.groupName, equipped_outfit.name, outfit.forms);
+		if (outfit_index < 0)
 			return false; //Outfit not found
 
-		sOutfits[outfit_index].forms = outfit.forms;  //Replace the formlist for the outfit
-		saveGroupFile(group_it->second); //Save the group file
 		setOutfit(actor, outfit_index, true); //Update the actor outfit
 
 		return true;
@@ -646,33 +557,32 @@ namespace OutfitPlaylist
 
 	bool PapyrusRenameCurrentOutfit(RE::StaticFunctionTag*, Actor* actor, std::string name)
 	{
+		PerfTimer timer(kPerfRenameCurrentOutfit);
+		TracedCall trace(kPerfRenameCurrentOutfit, traceActor(actor), name);
+
 		//Get current outfit for the actor
-		Outfit* equipped_outfit = getActorEquippedOutfit(actor);
-		if (!equipped_outfit)
+		Outfit equipped_outfit;
+		if (!getActorEquippedOutfit(actor, equipped_outfit))
 			return false; //No current outfit
 
-		OutfitGroupMap::iterator group_it = sOutfitGroups.find(equipped_outfit->groupName);
-		if (group_it == sOutfitGroups.end())
-			return false; //Group not found
-
-		int outfit_index = getOutfitIndex(equipped_outfit->groupName, equipped_outfit->name);
-		if (outfit_index < 0 || outfit_index >= sOutfits.size())
+		int outfit_index = renameOutfit(equipped_outfit.groupName, equipped_outfit.name, name);
+		if (outfit_index < 0)
 			return false; //Outfit not found
 
-		sOutfits[outfit_index].name = makeNameUniqueForGroup(group_it->second, name, equipped_outfit->name);  //Update the outfit name
-		saveGroupFile(group_it->second); //Save the group file
-		setOutfit(actor, outfit_index, equipped_outfit->doNotRemove); //Update the actor outfit
+		setOutfit(actor, outfit_index, equipped_outfit.doNotRemove); //Update the actor outfit
 
 		return true;
 	}
 
 	std::vector<std::string> PapyrusGetGroupNames(RE::StaticFunctionTag*)
 	{
-		std::vector<std::string> result;
+		PerfTimer timer(kPerfGetGroupNames);
+		TracedCall trace(kPerfGetGroupNames);
 
-		log::info("Get Group Names");
+		std::vector<std::string> result;
 
-		for (OutfitGroupMap::iterator it = sOutfitGroups.begin(); it != sOutfitGroups.end(); ++it) {
+		CatalogPtr catalog = getCatalog();
+		for (OutfitGroupMap::const_iterator it = catalog->groups.begin(); it != catalog->groups.end(); ++it) {
 			result.push_back(it->first);
 		}
 
@@ -681,20 +591,60 @@ namespace OutfitPlaylist
 
 	std::vector<std::string> PapyrusGetGroupOutfitNames(RE::StaticFunctionTag*, std::string group_name)
 	{
-		std::vector<std::string> result;
+		PerfTimer timer(kPerfGetGroupOutfitNames);
+		TracedCall trace(kPerfGetGroupOutfitNames, group_name);
 
-		log::info("Get Group Outfit Names {}", group_name);
+		std::vector<std::string> result;
 
-		OutfitGroupMap::iterator it = sOutfitGroups.find(group_name);
-		if (it != sOutfitGroups.end()) {
+		CatalogPtr catalog = getCatalog();
+		OutfitGroupMap::const_iterator it = catalog->groups.find(group_name);
+		if (it != catalog->groups.end()) {
 			
 			for (unsigned int i = 0u; i < it->second.outfitIndices.size(); i++) {
-				result.push_back(sOutfits[it->second.outfitIndices[i]].name);
+				result.push_back(catalog->outfits[it->second.outfitIndices[i]].name);
 			}
 		}
 		return result;
 	}
 
+	std::vector<std::string> PapyrusGetPerfStats(RE::StaticFunctionTag*, bool reset)
+	{
+		PerfTimer timer(kPerfGetPerfStats);
+		TracedCall trace(kPerfGetPerfStats, reset);
+
+		std::vector<std::string> result;
+		getPerfSummary(result);
+		if (reset)
+			resetPerfStats();
+		return result;
+	}
+
+	void PapyrusLogPerfStats(RE::StaticFunctionTag*)
+	{
+		PerfTimer timer(kPerfLogPerfStats);
+		TracedCall trace(kPerfLogPerfStats);
+
+		logPerfSummary();
+	}
+
+	std::vector<std::string> PapyrusGetMemoryStats(RE::StaticFunctionTag*)
+	{
+		PerfTimer timer(kPerfGetMemoryStats);
+		TracedCall trace(kPerfGetMemoryStats);
+
+		std::vector<std::string> result;
+		getMemorySummary(result);
+		return result;
+	}
+
+	int PapyrusCompactCatalog(RE::StaticFunctionTag*)
+	{
+		PerfTimer timer(kPerfCompactCatalog);
+		TracedCall trace(kPerfCompactCatalog);
+
+		return static_cast<int>(CompactCatalog());
+	}
+
 	bool RegisterFunctions(RE::BSScript::IVirtualMachine* vm)
 	{
 		log::info("Registered papyrus functions");
@@ -704,17 +654,35 @@ namespace OutfitPlaylist
 		vm->RegisterFunction("GetOutfitName", OPLQuest, PapyrusGetOutfitName);
 		vm->RegisterFunction("GetOutfitGroupName", OPLQuest, PapyrusGetOutfitGroupName);
 		vm->RegisterFunction("GetOutfitIndex", OPLQuest, PapyrusGetOutfitIndex);
+		vm->RegisterFunction("GetOutfitID", OPLQuest, PapyrusGetOutfitID);
+		vm->RegisterFunction("GetOutfitIndexByID", OPLQuest, PapyrusGetOutfitIndexByID);
 		vm->RegisterFunction("GetActorOutfitGroupName", OPLQuest, PapyrusGetActorOutfitGroupName);
 		vm->RegisterFunction("GetActorOutfitName", OPLQuest, PapyrusGetActorOutfitName);
+		vm->RegisterFunction("GetActorOutfitInfo", OPLQuest, PapyrusGetActorOutfitInfo);
 		vm->RegisterFunction("ExtSetOutfit", OPLQuest, PapyrusSetOutfit);
+		vm->RegisterFunction("ExtSetOutfitByID", OPLQuest, PapyrusSetOutfitByID);
 		vm->RegisterFunction("ExtClearOutfit", OPLQuest, PapyrusClearOutfit);
 		vm->RegisterFunction("GetShuffledOutfitIndex", OPLQuest, PapyrusGetShuffledOutfitIndex);
 		vm->RegisterFunction("GetOutfitShuffleIndex", OPLQuest, PapyrusGetOutfitShuffleIndex);
+		vm->RegisterFunction("GetNumContextOutfits", OPLQuest, PapyrusGetNumContextOutfits);
+		vm->RegisterFunction("GetContextOutfitIndex", OPLQuest, PapyrusGetContextOutfitIndex);
+		vm->RegisterFunction("GetGroupPlaylistSize", OPLQuest, PapyrusGetGroupPlaylistSize);
+		vm->RegisterFunction("GetGroupShuffledOutfitIndex", OPLQuest, PapyrusGetGroupShuffledOutfitIndex);
+		vm->RegisterFunction("GetGroupOutfitShuffleIndex", OPLQuest, PapyrusGetGroupOutfitShuffleIndex);
+		vm->RegisterFunction("GetNonRepeatingOutfitIndex", OPLQuest, PapyrusGetNonRepeatingOutfitIndex);
+		vm->RegisterFunction("ClearOutfitHistory", OPLQuest, PapyrusClearOutfitHistory);
+		vm->RegisterFunction("GetOutfitWeight", OPLQuest, PapyrusGetOutfitWeight);
+		vm->RegisterFunction("GetWeightedOutfitIndex", OPLQuest, PapyrusGetWeightedOutfitIndex);
+		vm->RegisterFunction("GetOutfitSlotMask", OPLQuest, PapyrusGetOutfitSlotMask);
 		vm->RegisterFunction("RegisterCurrentOutfit", OPLQuest, PapyrusRegisterCurrentOutfit);
 		vm->RegisterFunction("ReplaceCurrentOutfit", OPLQuest, PapyrusReplaceCurrentOutfit);
 		vm->RegisterFunction("RenameCurrentOutfit", OPLQuest, PapyrusRenameCurrentOutfit);
 		vm->RegisterFunction("GetGroupNames", OPLQuest, PapyrusGetGroupNames);
 		vm->RegisterFunction("GetGroupOutfitNames", OPLQuest, PapyrusGetGroupOutfitNames);
+		vm->RegisterFunction("GetPerfStats", OPLQuest, PapyrusGetPerfStats);
+		vm->RegisterFunction("LogPerfStats", OPLQuest, PapyrusLogPerfStats);
+		vm->RegisterFunction("GetMemoryStats", OPLQuest, PapyrusGetMemoryStats);
+		vm->RegisterFunction("CompactCatalog", OPLQuest, PapyrusCompactCatalog);
 
 		return true;
 	}
@@ -3,36 +3,19 @@
 #include <RE/Skyrim.h>
 #include <SKSE/SKSE.h>
 
+#include "core/Catalog.h"
+#include "core/ActorState.h"
+
 namespace OutfitPlaylist
 {
-	typedef std::vector<RE::TESForm*> FormVec;
-	typedef std::vector<unsigned int> IndexVec;
-
-	struct Outfit
-	{
-		std::string name;
-		std::string groupName;
-		FormVec forms;
-		bool doNotRemove;
-		Outfit();
-	};
-
-	struct OutfitGroup
-	{
-		std::string name;
-		IndexVec outfitIndices;
-	};
-
 	//Plugin
 	void LoadPluginData();
 	void OnGameLoaded(SKSE::SerializationInterface* serde);
 	void OnGameSaved(SKSE::SerializationInterface* serde);
 
 	//Outfits
-	Outfit* setOutfit(RE::Actor* actor, unsigned int index, bool do_not_remove=false);
-	void clearOutfit(RE::Actor* actor, FormVec* forms_out = NULL);
-
-	bool outfitFormsAreTheSame(Outfit& outfit1, Outfit& outfit2);
+	bool setOutfit(RE::Actor* actor, unsigned int index, bool do_not_remove=false, NativeFormArray* forms_out = NULL);
+	void clearOutfit(RE::Actor* actor, NativeFormArray* forms_out = NULL);
 
 	//Papyrus
 	bool RegisterFunctions(RE::BSScript::IVirtualMachine* vm);
@@ -0,0 +1,126 @@
+#include "SKSEGameData.h"
+#include "SKSEUtil/FormIDUtil.h"
+#include "SKSEUtil/JSONUtil.h"
+
+using namespace RE;
+
+namespace OutfitPlaylist
+{
+	//SKSEFormResolver
+
+	bool SKSEFormResolver::deserializeForm(const Json::Value& json, GameForm*& form_out) const
+	{
+		form_out = NULL;
+
+		FormID form_id;
+		std::string mod_name;
+		if (!SKSEUtil::deserializeFormID(json, form_id, mod_name))
+			return false;
+
+		form_out = TESDataHandler::GetSingleton()->LookupForm(form_id, mod_name);
+		return true;
+	}
+
+	void SKSEFormResolver::serializeForm(const GameForm* form, Json::Value& json_out) const
+	{
+		SKSEUtil::serializeFormID(form->formID, json_out);
+	}
+
+	bool SKSEFormResolver::parseFormReference(const Json::Value& json, std::string& mod_name_out, FormID& local_form_id_out) const
+	{
+		return SKSEUtil::deserializeFormID(json, local_form_id_out, mod_name_out);
+	}
+
+	bool SKSEFormResolver::isPluginLoaded(const std::string& mod_name) const
+	{
+		//LookupModByName also finds plugins that are installed but not active
+		TESDataHandler* data_handler = TESDataHandler::GetSingleton();
+		return data_handler->LookupLoadedModByName(mod_name) != NULL || data_handler->LookupLoadedLightModByName(mod_name) != NULL;
+	}
+
+	GameForm* SKSEFormResolver::lookupPluginForm(const std::string& mod_name, FormID local_form_id) const
+	{
+		return TESDataHandler::GetSingleton()->LookupForm(local_form_id, mod_name);
+	}
+
+	GameForm* SKSEFormResolver::lookupForm(FormID form_id) const
+	{
+		return TESForm::LookupByID<TESForm>(form_id);
+	}
+
+	FormID SKSEFormResolver::getFormID(const GameForm* form) const
+	{
+		return form->formID;
+	}
+
+	bool SKSEFormResolver::actorExists(FormID actor_id) const
+	{
+		return TESForm::LookupByID<Actor>(actor_id) != NULL;
+	}
+
+	ActorStatus SKSEFormResolver::getActorStatus(FormID actor_id) const
+	{
+		Actor* actor = TESForm::LookupByID<Actor>(actor_id);
+		if (!actor)
+			return kActorMissing;
+		return actor->IsDeleted() ? kActorDeleted : kActorPresent;
+	}
+
+	std::uint8_t SKSEFormResolver::getFormType(const GameForm* form) const
+	{
+		return static_cast<std::uint8_t>(form->GetFormType());
+	}
+
+	bool SKSEFormResolver::isOutfitFormType(std::uint8_t form_type) const
+	{
+		FormType type = static_cast<FormType>(form_type);
+		return type == FormType::Armor || type == FormType::Weapon || type == FormType::Ammo || type == FormType::Light;
+	}
+
+	std::uint32_t SKSEFormResolver::getSlotMask(const GameForm* form) const
+	{
+		const BGSBipedObjectForm* biped_form = form->As<BGSBipedObjectForm>();
+		return biped_form ? static_cast<std::uint32_t>(biped_form->GetSlotMask()) : 0u;
+	}
+
+	//SKSERecordSerializer
+
+	SKSERecordSerializer::SKSERecordSerializer(SKSE::SerializationInterface* serde)
+		: mSerde(serde) {}
+
+	bool SKSERecordSerializer::getNextRecordInfo(std::uint32_t& type, std::uint32_t& version, std::uint32_t& length)
+	{
+		return mSerde->GetNextRecordInfo(type, version, length);
+	}
+
+	bool SKSERecordSerializer::readRecordJson(Json::Value& json_out)
+	{
+		return SKSEUtil::deserializeJsonFromRecord(mSerde, json_out);
+	}
+
+	bool SKSERecordSerializer::readRecordData(std::string& data_out, std::uint32_t length)
+	{
+		data_out.resize(length);
+		return length == 0u || mSerde->ReadRecordData(data_out.data(), length) == length;
+	}
+
+	bool SKSERecordSerializer::openRecord(std::uint32_t type, std::uint32_t version)
+	{
+		return mSerde->OpenRecord(type, version);
+	}
+
+	bool SKSERecordSerializer::writeRecordJson(const Json::Value& json)
+	{
+		return SKSEUtil::serializeJsonToRecord(mSerde, json);
+	}
+
+	bool SKSERecordSerializer::writeRecordData(const std::string& data)
+	{
+		return mSerde->WriteRecordData(data.data(), static_cast<std::uint32_t>(data.size()));
+	}
+
+	bool SKSERecordSerializer::resolveFormID(FormID old_form_id, FormID& form_id_out)
+	{
+		return mSerde->ResolveFormID(old_form_id, form_id_out);
+	}
+}
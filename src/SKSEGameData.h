@@ -0,0 +1,42 @@
+#pragma once
+
+#include "core/GameData.h"
+
+namespace OutfitPlaylist
+{
+	//Core game data backed by the loaded plugins
+	class SKSEFormResolver : public FormResolver
+	{
+	public:
+		virtual bool deserializeForm(const Json::Value& json, GameForm*& form_out) const override;
+		virtual void serializeForm(const GameForm* form, Json::Value& json_out) const override;
+		virtual bool parseFormReference(const Json::Value& json, std::string& mod_name_out, FormID& local_form_id_out) const override;
+		virtual bool isPluginLoaded(const std::string& mod_name) const override;
+		virtual GameForm* lookupPluginForm(const std::string& mod_name, FormID local_form_id) const override;
+		virtual GameForm* lookupForm(FormID form_id) const override;
+		virtual FormID getFormID(const GameForm* form) const override;
+		virtual bool actorExists(FormID actor_id) const override;
+		virtual ActorStatus getActorStatus(FormID actor_id) const override;
+		virtual std::uint8_t getFormType(const GameForm* form) const override;
+		virtual bool isOutfitFormType(std::uint8_t form_type) const override;
+		virtual std::uint32_t getSlotMask(const GameForm* form) const override;
+	};
+
+	//Core cosave records backed by the SKSE serialization interface
+	class SKSERecordSerializer : public RecordSerializer
+	{
+	public:
+		SKSERecordSerializer(SKSE::SerializationInterface* serde);
+
+		virtual bool getNextRecordInfo(std::uint32_t& type, std::uint32_t& version, std::uint32_t& length) override;
+		virtual bool readRecordJson(Json::Value& json_out) override;
+		virtual bool readRecordData(std::string& data_out, std::uint32_t length) override;
+		virtual bool openRecord(std::uint32_t type, std::uint32_t version) override;
+		virtual bool writeRecordJson(const Json::Value& json) override;
+		virtual bool writeRecordData(const std::string& data) override;
+		virtual bool resolveFormID(FormID old_form_id, FormID& form_id_out) override;
+
+	private:
+		SKSE::SerializationInterface* mSerde;
+	};
+}
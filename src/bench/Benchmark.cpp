@@ -0,0 +1,447 @@
+#include "core/ActorState.h"
+#include "core/Catalog.h"
+#include "core/MemoryUsage.h"
+#include "core/fake/FakeGameData.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+//Headless benchmark over a synthetic catalog, results are written as JSON.
+//Usage: OutfitPlaylistBench [--groups N] [--outfits N] [--forms N] [--actors N] [--iterations N] [--lazy 1] [--dir path] [--out file]
+
+using namespace OutfitPlaylist;
+
+//Every heap allocation is counted, so results can report allocations per call
+std::atomic<std::uint64_t> sAllocationCount(0u);
+
+void* operator new(std::size_t size)
+{
+	sAllocationCount.fetch_add(1u, std::memory_order_relaxed);
+	if (void* data = std::malloc(size ? size : 1u))
+		return data;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* data) noexcept
+{
+	std::free(data);
+}
+
+void operator delete(void* data, std::size_t) noexcept
+{
+	std::free(data);
+}
+
+struct BenchConfig
+{
+	unsigned int groups;
+	unsigned int outfits; //Per group
+	unsigned int forms; //Per outfit
+	unsigned int formPool; //Distinct forms shared by every outfit
+	unsigned int actors;
+	unsigned int iterations;
+	unsigned int loadIterations;
+	unsigned int seed;
+	bool lazy;
+	std::string dir;
+	std::string out;
+	BenchConfig();
+};
+
+BenchConfig::BenchConfig()
+	: groups(50u), outfits(100u), forms(6u), formPool(20000u), actors(500u), iterations(10000u), loadIterations(5u), seed(1u), lazy(false),
+	dir((std::filesystem::temp_directory_path() / "OutfitPlaylistBench").string()) {}
+
+const std::string BenchModName = "Synthetic.esp";
+const std::string BenchCustomGroupName = "BenchCustom";
+const FormID BenchFirstLocalFormID = 0x800u;
+const FormID BenchFirstActorID = 0xFF000800u;
+
+bool parseArgs(int argc, char** argv, BenchConfig& config)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			std::cerr << "Missing value for " << arg << std::endl;
+			return false;
+		}
+
+		std::string value = argv[++i];
+		if (arg == "--dir")
+			config.dir = value;
+		else if (arg == "--out")
+			config.out = value;
+		else {
+			unsigned int number = static_cast<unsigned int>(std::strtoul(value.c_str(), NULL, 10));
+			if (arg == "--groups")
+				config.groups = std::max(number, 1u);
+			else if (arg == "--outfits")
+				config.outfits = std::max(number, 1u);
+			else if (arg == "--forms")
+				config.forms = number;
+			else if (arg == "--form-pool")
+				config.formPool = std::max(number, 1u);
+			else if (arg == "--actors")
+				config.actors = number;
+			else if (arg == "--iterations")
+				config.iterations = std::max(number, 1u);
+			else if (arg == "--load-iterations")
+				config.loadIterations = std::max(number, 1u);
+			else if (arg == "--seed")
+				config.seed = number;
+			else if (arg == "--lazy")
+				config.lazy = number != 0u;
+			else {
+				std::cerr << "Unknown argument " << arg << std::endl;
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+std::string getGroupName(unsigned int group)
+{
+	return "Group" + std::to_string(group);
+}
+
+std::string getOutfitName(unsigned int outfit)
+{
+	return "Outfit" + std::to_string(outfit);
+}
+
+//Writes the synthetic group files, every outfit draws its forms from the shared pool
+void generateGroupFiles(const BenchConfig& config, FakeFormResolver& resolver, FormVec& form_pool_out)
+{
+	form_pool_out.clear();
+	for (unsigned int i = 0u; i < config.formPool; i++)
+		form_pool_out.push_back(resolver.addForm(BenchModName, BenchFirstLocalFormID + i));
+
+	std::filesystem::remove_all(config.dir);
+	std::filesystem::create_directories(config.dir);
+
+	for (unsigned int g = 0u; g < config.groups; g++) {
+		Json::Value group_json;
+		Json::Value& outfits_json = group_json["outfits"];
+		for (unsigned int o = 0u; o < config.outfits; o++) {
+			Json::Value& forms_json = outfits_json[getOutfitName(o)];
+			forms_json = Json::Value(Json::arrayValue);
+
+			unsigned int outfit_id = g * config.outfits + o;
+			for (unsigned int f = 0u; f < config.forms; f++) {
+				FormID local_form_id = BenchFirstLocalFormID + static_cast<FormID>(mixSeed(config.seed, outfit_id * config.forms + f) % config.formPool);
+				forms_json.append(FakeFormResolver::formReference(BenchModName, local_form_id));
+			}
+		}
+
+		std::ofstream group_file(config.dir + "/" + getGroupName(g) + ".json");
+		Json::FastWriter writer;
+		group_file << writer.write(group_json);
+	}
+}
+
+//Times func(i) for each iteration and adds the latency distribution to results
+template <class Func>
+void runBench(Json::Value& results, const char* name, unsigned int iterations, Func func)
+{
+	std::vector<std::uint64_t> samples;
+	samples.reserve(iterations);
+
+	std::uint64_t allocations = sAllocationCount.load();
+	for (unsigned int i = 0u; i < iterations; i++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		func(i);
+		samples.push_back(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+	}
+	allocations = sAllocationCount.load() - allocations;
+
+	std::uint64_t total = 0u;
+	for (std::uint64_t sample : samples)
+		total += sample;
+	std::sort(samples.begin(), samples.end());
+
+	Json::Value& result_json = results[name];
+	result_json["iterations"] = iterations;
+	result_json["totalMs"] = total / 1.0e6;
+	result_json["meanUs"] = total / 1.0e3 / iterations;
+	result_json["minUs"] = samples.front() / 1.0e3;
+	result_json["p50Us"] = samples[samples.size() / 2u] / 1.0e3;
+	result_json["p90Us"] = samples[samples.size() * 9u / 10u] / 1.0e3;
+	result_json["p99Us"] = samples[samples.size() * 99u / 100u] / 1.0e3;
+	result_json["maxUs"] = samples.back() / 1.0e3;
+	result_json["allocsPerCall"] = static_cast<double>(allocations) / iterations;
+
+	std::cerr << name << ": " << result_json["meanUs"].asDouble() << "us mean, " << result_json["allocsPerCall"].asDouble() << " allocations" << std::endl;
+}
+
+//Runs func(thread, i) for iterations calls on each of 1, 2, 4 and 8 threads started together
+//and adds the combined throughput to results
+template <class Func>
+void runThreadedBench(Json::Value& results, const char* name, unsigned int iterations, Func func)
+{
+	Json::Value& result_json = results[name];
+	for (unsigned int threads = 1u; threads <= 8u; threads *= 2u) {
+		std::atomic<bool> started(false);
+		std::vector<std::thread> workers;
+		for (unsigned int t = 0u; t < threads; t++) {
+			workers.emplace_back([&, t]() {
+				while (!started.load(std::memory_order_acquire))
+					std::this_thread::yield();
+				for (unsigned int i = 0u; i < iterations; i++)
+					func(t, i);
+			});
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		started.store(true, std::memory_order_release);
+		for (std::thread& worker : workers)
+			worker.join();
+		double total_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+		Json::Value& thread_json = result_json[std::to_string(threads)];
+		thread_json["calls"] = threads * iterations;
+		thread_json["totalMs"] = total_ns / 1.0e6;
+		thread_json["callsPerSec"] = threads * iterations / (total_ns / 1.0e9);
+
+		std::cerr << name << " x" << threads << ": " << thread_json["callsPerSec"].asDouble() << " calls/s" << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchConfig config;
+	if (!parseArgs(argc, argv, config))
+		return 1;
+
+	//Keep stdout for the report, core warnings and errors still reach stderr
+	spdlog::set_default_logger(spdlog::stderr_color_mt("bench"));
+	spdlog::set_level(spdlog::level::warn);
+
+	FakeFormResolver resolver;
+	FormVec form_pool;
+	SetFormResolver(&resolver);
+	generateGroupFiles(config, resolver, form_pool);
+
+	Json::Value report;
+	Json::Value& config_json = report["config"];
+	config_json["groups"] = config.groups;
+	config_json["outfitsPerGroup"] = config.outfits;
+	config_json["formsPerOutfit"] = config.forms;
+	config_json["formPool"] = config.formPool;
+	config_json["actors"] = config.actors;
+	config_json["iterations"] = config.iterations;
+	config_json["seed"] = config.seed;
+	config_json["lazy"] = config.lazy;
+	config_json["hardwareThreads"] = std::thread::hardware_concurrency();
+
+	Json::Value& results = report["results"];
+	Json::Value catalog_config_json;
+	catalog_config_json["lazyGroupLoading"] = config.lazy;
+
+	runBench(results, "load", config.loadIterations, [&](unsigned int) {
+		LoadCatalog(config.dir, catalog_config_json);
+	});
+
+	//Lazy loads only scan the files, time resolving every group after the fact
+	if (config.lazy) {
+		runBench(results, "materializeOutfitGroup", config.groups, [&](unsigned int i) {
+			materializeOutfitGroup(getGroupName(i));
+		});
+	}
+
+	CatalogPtr catalog = getCatalog();
+	report["catalog"]["outfits"] = static_cast<unsigned int>(catalog->outfits.size());
+	report["catalog"]["groups"] = static_cast<unsigned int>(catalog->groups.size());
+
+	//Lookups
+	std::vector<std::pair<std::string, std::string>> lookups;
+	lookups.reserve(config.iterations);
+	for (unsigned int i = 0u; i < config.iterations; i++) {
+		std::uint64_t random = mixSeed(config.seed, i);
+		lookups.push_back(std::pair<std::string, std::string>(getGroupName(random % config.groups), getOutfitName((random >> 32) % config.outfits)));
+	}
+
+	int lookup_sink = 0;
+	runBench(results, "getOutfitIndex", config.iterations, [&](unsigned int i) {
+		lookup_sink += getOutfitIndex(*catalog, lookups[i].first, lookups[i].second);
+	});
+
+	//Lowercased names miss the case-sensitive pass
+	for (std::pair<std::string, std::string>& lookup : lookups)
+		std::transform(lookup.second.begin(), lookup.second.end(), lookup.second.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+
+	runBench(results, "getOutfitIndexIgnoreCase", config.iterations, [&](unsigned int i) {
+		lookup_sink += getOutfitIndex(*catalog, lookups[i].first, lookups[i].second);
+	});
+
+	report["lookupChecksum"] = lookup_sink;
+
+	//Form lists returned by natives, the vector copy is how they were returned before
+	std::size_t forms_sink = 0u;
+	runBench(results, "outfitFormsVectorCopy", config.iterations, [&](unsigned int i) {
+		FormVec forms = catalog->outfits[mixSeed(config.seed + 3u, i) % catalog->outfits.size()].forms;
+		forms_sink += forms.size();
+	});
+
+	runBench(results, "outfitFormsNativeArray", config.iterations, [&](unsigned int i) {
+		const FormVec& outfit_forms = catalog->outfits[mixSeed(config.seed + 3u, i) % catalog->outfits.size()].forms;
+		NativeFormArray forms(outfit_forms.begin(), outfit_forms.end());
+		forms_sink += forms.size();
+	});
+
+	//Actors keep their map entry between equips, clearing takes it away again
+	runBench(results, "setActorOutfit", config.iterations, [&](unsigned int i) {
+		NativeFormArray forms;
+		setActorOutfit(BenchFirstActorID + i % config.actors, static_cast<unsigned int>(mixSeed(config.seed + 4u, i) % catalog->outfits.size()), false, &forms);
+		forms_sink += forms.size();
+	});
+
+	//Name and group back to back per actor, the two full copies are how scripts asked before
+	std::size_t info_sink = 0u;
+	runBench(results, "actorOutfitCopies", config.iterations, [&](unsigned int i) {
+		Outfit outfit;
+		if (getActorOutfit(BenchFirstActorID + i % config.actors, outfit))
+			info_sink += outfit.name.size();
+		if (getActorOutfit(BenchFirstActorID + i % config.actors, outfit))
+			info_sink += outfit.groupName.size();
+	});
+
+	runBench(results, "actorOutfitInfo", config.iterations, [&](unsigned int i) {
+		ActorOutfitInfo info;
+		if (getActorOutfitInfo(BenchFirstActorID + i % config.actors, info))
+			info_sink += info.name.size() + info.groupName.size();
+	});
+
+	report["infoChecksum"] = static_cast<Json::UInt64>(info_sink);
+
+	runBench(results, "clearActorOutfit", config.actors, [&](unsigned int i) {
+		NativeFormArray forms;
+		clearActorOutfit(BenchFirstActorID + i, &forms);
+		forms_sink += forms.size();
+	});
+
+	report["formsChecksum"] = static_cast<Json::UInt64>(forms_sink);
+
+	//Actor state under contention, each thread equips its own actors so only the locks are shared
+	std::atomic<std::size_t> threaded_sink(0u);
+	runThreadedBench(results, "setActorOutfitThreaded", config.iterations, [&](unsigned int t, unsigned int i) {
+		setActorOutfit(BenchFirstActorID + t * config.actors + i % config.actors, static_cast<unsigned int>(mixSeed(config.seed + 5u, i) % catalog->outfits.size()), false);
+	});
+
+	runThreadedBench(results, "getActorOutfitThreaded", config.iterations, [&](unsigned int t, unsigned int i) {
+		Outfit outfit;
+		if (getActorOutfit(BenchFirstActorID + t * config.actors + i % config.actors, outfit))
+			threaded_sink.fetch_add(outfit.forms.size(), std::memory_order_relaxed);
+	});
+
+	for (unsigned int a = 0u; a < 8u * config.actors; a++)
+		clearActorOutfit(BenchFirstActorID + a);
+	report["threadedChecksum"] = static_cast<Json::UInt64>(threaded_sink.load());
+
+	//Playlists
+	unsigned int shuffle_iterations = std::max(config.iterations / 100u, 1u);
+	runBench(results, "shuffleOutfits", shuffle_iterations, [&](unsigned int i) {
+		shuffleOutfits(*catalog, config.seed + i + 1u);
+	});
+
+	runBench(results, "shuffleOutfitsCached", config.iterations, [&](unsigned int) {
+		shuffleOutfits(*catalog, config.seed);
+	});
+
+	std::vector<std::string> playlist_groups;
+	for (unsigned int g = 0u; g < std::min(config.groups, 4u); g++)
+		playlist_groups.push_back(getGroupName(g));
+
+	runBench(results, "getGroupPlaylist", shuffle_iterations, [&](unsigned int i) {
+		getGroupPlaylist(*catalog, playlist_groups, static_cast<int>(config.seed + i + 1u));
+	});
+
+	runBench(results, "getGroupPlaylistCached", config.iterations, [&](unsigned int) {
+		getGroupPlaylist(*catalog, playlist_groups, static_cast<int>(config.seed));
+	});
+
+	//Saving
+	const OutfitGroup& save_group = catalog->groups.begin()->second;
+	runBench(results, "saveGroupFile", shuffle_iterations, [&](unsigned int) {
+		saveGroupFile(*catalog, save_group);
+	});
+
+	//Register saves the custom group file on every call, as it does in game
+	unsigned int register_iterations = std::min(config.iterations, 200u);
+	std::vector<Outfit> registered_outfits(register_iterations);
+	for (unsigned int i = 0u; i < register_iterations; i++) {
+		registered_outfits[i].name = "Registered";
+		for (unsigned int f = 0u; f < std::max(config.forms, 1u); f++)
+			registered_outfits[i].forms.push_back(form_pool[mixSeed(config.seed + 1u, i * config.forms + f) % config.formPool]);
+	}
+
+	unsigned int registered = 0u;
+	runBench(results, "registerOutfit", register_iterations, [&](unsigned int i) {
+		unsigned int index;
+		if (registerOutfit(registered_outfits[i], BenchCustomGroupName, index))
+			registered++;
+	});
+
+	runBench(results, "registerOutfitDuplicate", register_iterations, [&](unsigned int i) {
+		unsigned int index;
+		registerOutfit(registered_outfits[i], BenchCustomGroupName, index);
+	});
+
+	report["registeredOutfits"] = registered;
+
+	//Cosave
+	catalog = getCatalog();
+	for (unsigned int a = 0u; a < config.actors; a++) {
+		resolver.addActor(BenchFirstActorID + a);
+		setActorOutfit(BenchFirstActorID + a, static_cast<unsigned int>(mixSeed(config.seed + 2u, a) % catalog->outfits.size()), false);
+	}
+
+	FakeRecordSerializer serializer;
+	unsigned int cosave_iterations = std::max(config.iterations / 100u, 1u);
+	runBench(results, "saveActorState", cosave_iterations, [&](unsigned int) {
+		serializer.clear();
+		saveActorState(serializer);
+	});
+
+	report["cosaveBytes"] = static_cast<Json::UInt64>(serializer.getSize());
+
+	runBench(results, "loadActorState", cosave_iterations, [&](unsigned int) {
+		clearActorState();
+		serializer.rewind();
+		loadActorState(serializer);
+	});
+
+	//Memory
+	MemoryUsage usage;
+	getMemoryUsage(usage);
+	Json::Value& memory_json = report["memory"];
+	memory_json["totalBytes"] = static_cast<Json::UInt64>(usage.getTotal());
+	memory_json["outfitBytes"] = static_cast<Json::UInt64>(usage.outfits);
+	memory_json["formBytes"] = static_cast<Json::UInt64>(usage.forms);
+	memory_json["groupBytes"] = static_cast<Json::UInt64>(usage.groups);
+	memory_json["actorStateBytes"] = static_cast<Json::UInt64>(usage.actorState);
+	memory_json["cacheBytes"] = static_cast<Json::UInt64>(usage.caches);
+	memory_json["compactedBytes"] = static_cast<Json::UInt64>(CompactCatalog());
+
+	std::filesystem::remove_all(config.dir);
+
+	Json::StyledStreamWriter writer;
+	if (config.out.empty())
+		writer.write(std::cout, report);
+	else {
+		std::ofstream out_file(config.out);
+		writer.write(out_file, report);
+	}
+
+	return 0;
+}
@@ -0,0 +1,42 @@
+#include "core/OutfitPack.h"
+#include "core/fake/FakeGameData.h"
+
+#include <filesystem>
+#include <iostream>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+//Converts group files into an outfit pack for shipping, the plugins don't have to be present.
+//Usage: OutfitPlaylistPack <group dir> <pack file>
+//Group files must use "Mod.esp|0x800" references. Use "exportOutfitPack" in the game's config
+//for any other reference format.
+
+using namespace OutfitPlaylist;
+
+int main(int argc, char** argv)
+{
+	if (argc != 3) {
+		std::cerr << "Usage: OutfitPlaylistPack <group dir> <pack file>" << std::endl;
+		return 1;
+	}
+
+	spdlog::set_default_logger(spdlog::stderr_color_mt("pack"));
+	spdlog::set_level(spdlog::level::warn);
+
+	std::string dir = argv[1];
+	if (!std::filesystem::is_directory(dir)) {
+		std::cerr << "Group directory not found " << dir << std::endl;
+		return 1;
+	}
+
+	FakeFormResolver resolver;
+	SetFormResolver(&resolver);
+
+	int group_count = ExportOutfitPack(dir, argv[2]);
+	if (group_count < 0)
+		return 1;
+
+	std::cerr << group_count << " groups, " << std::filesystem::file_size(argv[2]) << " bytes" << std::endl;
+	return 0;
+}
@@ -0,0 +1,388 @@
+#include "core/ActorState.h"
+#include "core/CallTrace.h"
+#include "core/CoreUtil.h"
+#include "core/Catalog.h"
+#include "core/MemoryUsage.h"
+#include "core/fake/FakeGameData.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+//Replays a native call trace against the headless core and reports per-native latency as JSON.
+//Usage: OutfitPlaylistReplay <trace> --dir <group dir> [--config file] [--paced 1] [--out file]
+//Group files must reference forms as "Mod.esp|0x800". Natives that read live game state
+//(context outfits, worn outfit capture) are counted but not replayed.
+
+using namespace OutfitPlaylist;
+
+struct ReplayConfig
+{
+	std::string tracePath;
+	std::string dir;
+	std::string configPath;
+	std::string out;
+	bool paced; //Sleep to reproduce the recorded call spacing
+	ReplayConfig();
+};
+
+ReplayConfig::ReplayConfig()
+	: paced(false) {}
+
+typedef std::function<int(const TraceCall&)> ReplayFunc;
+
+struct NativeStats
+{
+	std::vector<std::uint64_t> replayNanoseconds;
+	std::uint64_t recordedTotal;
+	std::uint64_t recordedMax;
+	NativeStats();
+};
+
+NativeStats::NativeStats()
+	: recordedTotal(0u), recordedMax(0u) {}
+
+bool parseArgs(int argc, char** argv, ReplayConfig& config)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (!arg.starts_with("--")) {
+			config.tracePath = arg;
+			continue;
+		}
+
+		if (i + 1 >= argc) {
+			std::cerr << "Missing value for " << arg << std::endl;
+			return false;
+		}
+
+		std::string value = argv[++i];
+		if (arg == "--dir")
+			config.dir = value;
+		else if (arg == "--config")
+			config.configPath = value;
+		else if (arg == "--out")
+			config.out = value;
+		else if (arg == "--paced")
+			config.paced = value != "0";
+		else {
+			std::cerr << "Unknown argument " << arg << std::endl;
+			return false;
+		}
+	}
+
+	if (config.tracePath.empty() || config.dir.empty()) {
+		std::cerr << "Usage: OutfitPlaylistReplay <trace> --dir <group dir> [--config file] [--paced 1] [--out file]" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//Registers every form the group files reference, so the fake resolver can load them
+void addGroupFileForms(const std::string& dir, FakeFormResolver& resolver)
+{
+	for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+		if (entry.path().extension() != ".json")
+			continue;
+
+		std::ifstream group_file(entry.path());
+		Json::Reader reader;
+		Json::Value group_json;
+		if (!reader.parse(group_file, group_json))
+			continue;
+
+		const Json::Value& outfits_json = group_json["outfits"];
+		for (Json::Value::const_iterator it = outfits_json.begin(); it != outfits_json.end(); ++it) {
+			for (unsigned int i = 0u; i < it->size(); i++) {
+				std::string reference = (*it)[i].asString();
+				std::size_t separator = reference.rfind('|');
+				if (separator != std::string::npos)
+					resolver.addForm(reference.substr(0u, separator), stringToFormID(reference.substr(separator + 1u)));
+			}
+		}
+	}
+}
+
+const TraceArg* getArg(const TraceCall& call, unsigned int i, TraceArgType type)
+{
+	if (i >= call.args.size() || call.args[i].type != type)
+		return NULL;
+	return &call.args[i];
+}
+
+int getIntArg(const TraceCall& call, unsigned int i)
+{
+	const TraceArg* arg = getArg(call, i, kTraceInt);
+	return arg ? arg->intValue : 0;
+}
+
+FormID getFormArg(const TraceCall& call, unsigned int i)
+{
+	const TraceArg* arg = getArg(call, i, kTraceForm);
+	return arg ? static_cast<FormID>(arg->intValue) : 0u;
+}
+
+bool getBoolArg(const TraceCall& call, unsigned int i)
+{
+	const TraceArg* arg = getArg(call, i, kTraceBool);
+	return arg ? arg->intValue != 0 : false;
+}
+
+const std::string& getStringArg(const TraceCall& call, unsigned int i)
+{
+	static const std::string empty;
+	const TraceArg* arg = getArg(call, i, kTraceString);
+	return arg ? arg->stringValue : empty;
+}
+
+const std::vector<std::string>& getStringArrayArg(const TraceCall& call, unsigned int i)
+{
+	static const std::vector<std::string> empty;
+	const TraceArg* arg = getArg(call, i, kTraceStringArray);
+	return arg ? arg->stringArray : empty;
+}
+
+//The core calls behind each replayable native, results feed a checksum so nothing is optimized out
+void buildReplayTable(std::map<std::string, ReplayFunc>& table)
+{
+	table["GetNumOutfits"] = [](const TraceCall&) {
+		return static_cast<int>(getCatalog()->outfits.size());
+	};
+	table["GetOutfitForms"] = [](const TraceCall& call) {
+		unsigned int index = static_cast<unsigned int>(getIntArg(call, 0u));
+		CatalogPtr catalog = materializeOutfit(index);
+		NativeFormArray forms;
+		if (index < catalog->outfits.size())
+			forms.assign(catalog->outfits[index].forms.begin(), catalog->outfits[index].forms.end());
+		return static_cast<int>(forms.size());
+	};
+	table["GetOutfitName"] = [](const TraceCall& call) {
+		CatalogPtr catalog = getCatalog();
+		unsigned int index = static_cast<unsigned int>(getIntArg(call, 0u));
+		std::string name = index < catalog->outfits.size() ? catalog->outfits[index].name : std::string();
+		return static_cast<int>(name.size());
+	};
+	table["GetOutfitGroupName"] = [](const TraceCall& call) {
+		CatalogPtr catalog = getCatalog();
+		unsigned int index = static_cast<unsigned int>(getIntArg(call, 0u));
+		std::string name = index < catalog->outfits.size() ? catalog->outfits[index].groupName : std::string();
+		return static_cast<int>(name.size());
+	};
+	table["GetOutfitIndex"] = [](const TraceCall& call) {
+		return getOutfitIndex(*getCatalog(), getStringArg(call, 0u), getStringArg(call, 1u));
+	};
+	table["GetOutfitID"] = [](const TraceCall& call) {
+		CatalogPtr catalog = getCatalog();
+		unsigned int index = static_cast<unsigned int>(getIntArg(call, 0u));
+		std::string outfit_id = index < catalog->outfits.size() ? outfitIDToString(catalog->outfits[index].id) : std::string();
+		return static_cast<int>(outfit_id.size());
+	};
+	table["GetOutfitIndexByID"] = [](const TraceCall& call) {
+		return getOutfitIndexByID(*getCatalog(), stringToOutfitID(getStringArg(call, 0u)));
+	};
+	table["GetActorOutfitGroupName"] = [](const TraceCall& call) {
+		ActorOutfitInfo info;
+		return getActorOutfitInfo(getFormArg(call, 0u), info) ? static_cast<int>(info.groupName.size()) : 0;
+	};
+	table["GetActorOutfitName"] = [](const TraceCall& call) {
+		ActorOutfitInfo info;
+		return getActorOutfitInfo(getFormArg(call, 0u), info) ? static_cast<int>(info.name.size()) : 0;
+	};
+	table["GetActorOutfitInfo"] = [](const TraceCall& call) {
+		ActorOutfitInfo info;
+		return getActorOutfitInfo(getFormArg(call, 0u), info) ? info.index : -1;
+	};
+	table["ExtSetOutfit"] = [](const TraceCall& call) {
+		NativeFormArray forms;
+		setActorOutfit(getFormArg(call, 0u), static_cast<unsigned int>(getIntArg(call, 1u)), false, &forms);
+		return static_cast<int>(forms.size());
+	};
+	table["ExtSetOutfitByID"] = [](const TraceCall& call) {
+		NativeFormArray forms;
+		int index = getOutfitIndexByID(*getCatalog(), stringToOutfitID(getStringArg(call, 1u)));
+		if (index >= 0)
+			setActorOutfit(getFormArg(call, 0u), static_cast<unsigned int>(index), false, &forms);
+		return static_cast<int>(forms.size());
+	};
+	table["ExtClearOutfit"] = [](const TraceCall& call) {
+		NativeFormArray forms;
+		clearActorOutfit(getFormArg(call, 0u), &forms);
+		return static_cast<int>(forms.size());
+	};
+	table["GetShuffledOutfitIndex"] = [](const TraceCall& call) {
+		return getShuffledOutfitIndex(*getCatalog(), getIntArg(call, 0u), getIntArg(call, 1u));
+	};
+	table["GetOutfitShuffleIndex"] = [](const TraceCall& call) {
+		return getOutfitShuffleIndex(*getCatalog(), getIntArg(call, 0u), getIntArg(call, 1u));
+	};
+	table["GetGroupPlaylistSize"] = [](const TraceCall& call) {
+		return static_cast<int>(getGroupPlaylist(*getCatalog(), getStringArrayArg(call, 0u), -1)->outfitIndices.size());
+	};
+	table["GetGroupShuffledOutfitIndex"] = [](const TraceCall& call) {
+		return getGroupShuffledOutfitIndex(*getCatalog(), getStringArrayArg(call, 0u), getIntArg(call, 1u), getIntArg(call, 2u));
+	};
+	table["GetGroupOutfitShuffleIndex"] = [](const TraceCall& call) {
+		return getGroupOutfitShuffleIndex(*getCatalog(), getStringArrayArg(call, 0u), getIntArg(call, 1u), getIntArg(call, 2u));
+	};
+	table["GetNonRepeatingOutfitIndex"] = [](const TraceCall& call) {
+		return getNonRepeatingOutfitIndex(*getCatalog(), getFormArg(call, 0u), getStringArrayArg(call, 1u), getIntArg(call, 2u), getIntArg(call, 3u));
+	};
+	table["ClearOutfitHistory"] = [](const TraceCall& call) {
+		clearActorHistory(getFormArg(call, 0u));
+		return 0;
+	};
+	table["GetOutfitWeight"] = [](const TraceCall& call) {
+		CatalogPtr catalog = getCatalog();
+		unsigned int index = static_cast<unsigned int>(getIntArg(call, 0u));
+		return index < catalog->outfits.size() ? static_cast<int>(catalog->outfits[index].weight * 1000.0f) : 0;
+	};
+	table["GetOutfitSlotMask"] = [](const TraceCall& call) {
+		unsigned int index = static_cast<unsigned int>(getIntArg(call, 0u));
+		CatalogPtr catalog = materializeOutfit(index);
+		return index < catalog->outfits.size() ? static_cast<int>(catalog->outfits[index].slotMask) : 0;
+	};
+	table["GetWeightedOutfitIndex"] = [](const TraceCall& call) {
+		return getWeightedOutfitIndex(*getCatalog(), getStringArg(call, 0u), getIntArg(call, 1u), getIntArg(call, 2u));
+	};
+	table["GetGroupNames"] = [](const TraceCall&) {
+		CatalogPtr catalog = getCatalog();
+		std::vector<std::string> result;
+		for (OutfitGroupMap::const_iterator it = catalog->groups.begin(); it != catalog->groups.end(); ++it)
+			result.push_back(it->first);
+		return static_cast<int>(result.size());
+	};
+	table["GetGroupOutfitNames"] = [](const TraceCall& call) {
+		CatalogPtr catalog = getCatalog();
+		std::vector<std::string> result;
+		OutfitGroupMap::const_iterator it = catalog->groups.find(getStringArg(call, 0u));
+		if (it != catalog->groups.end()) {
+			for (unsigned int i = 0u; i < it->second.outfitIndices.size(); i++)
+				result.push_back(catalog->outfits[it->second.outfitIndices[i]].name);
+		}
+		return static_cast<int>(result.size());
+	};
+	table["GetPerfStats"] = [](const TraceCall& call) {
+		std::vector<std::string> result;
+		getPerfSummary(result);
+		if (getBoolArg(call, 0u))
+			resetPerfStats();
+		return static_cast<int>(result.size());
+	};
+	table["LogPerfStats"] = [](const TraceCall&) {
+		logPerfSummary();
+		return 0;
+	};
+	table["GetMemoryStats"] = [](const TraceCall&) {
+		std::vector<std::string> result;
+		getMemorySummary(result);
+		return static_cast<int>(result.size());
+	};
+	table["CompactCatalog"] = [](const TraceCall&) {
+		return static_cast<int>(CompactCatalog());
+	};
+}
+
+int main(int argc, char** argv)
+{
+	ReplayConfig config;
+	if (!parseArgs(argc, argv, config))
+		return 1;
+
+	spdlog::set_default_logger(spdlog::stderr_color_mt("replay"));
+	spdlog::set_level(spdlog::level::warn);
+
+	std::vector<TraceCall> calls;
+	if (!readCallTrace(config.tracePath, calls))
+		return 1;
+
+	Json::Value config_json;
+	if (!config.configPath.empty()) {
+		std::ifstream config_file(config.configPath);
+		Json::Reader reader;
+		reader.parse(config_file, config_json);
+	}
+
+	FakeFormResolver resolver;
+	SetFormResolver(&resolver);
+	addGroupFileForms(config.dir, resolver);
+	LoadCatalog(config.dir, config_json);
+
+	std::map<std::string, ReplayFunc> replay_table;
+	buildReplayTable(replay_table);
+
+	std::map<std::string, NativeStats> stats;
+	std::map<std::string, unsigned int> skipped;
+	std::int64_t checksum = 0;
+
+	std::chrono::steady_clock::time_point replay_start = std::chrono::steady_clock::now();
+	for (const TraceCall& call : calls) {
+		std::map<std::string, ReplayFunc>::iterator func_it = replay_table.find(call.native);
+		if (func_it == replay_table.end()) {
+			skipped[call.native]++;
+			continue;
+		}
+
+		if (config.paced)
+			std::this_thread::sleep_until(replay_start + std::chrono::nanoseconds(call.startNanoseconds));
+
+		for (const TraceArg& arg : call.args) {
+			if (arg.type == kTraceForm)
+				resolver.addActor(static_cast<FormID>(arg.intValue));
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		checksum += func_it->second(call);
+		std::uint64_t replay_ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+		NativeStats& native_stats = stats[call.native];
+		native_stats.replayNanoseconds.push_back(replay_ns);
+		native_stats.recordedTotal += call.durationNanoseconds;
+		native_stats.recordedMax = std::max<std::uint64_t>(native_stats.recordedMax, call.durationNanoseconds);
+	}
+
+	Json::Value report;
+	report["trace"] = config.tracePath;
+	report["calls"] = static_cast<Json::UInt64>(calls.size());
+	report["checksum"] = static_cast<Json::Int64>(checksum);
+	report["catalogOutfits"] = static_cast<Json::UInt64>(getCatalog()->outfits.size());
+
+	Json::Value& natives_json = report["natives"];
+	for (std::map<std::string, NativeStats>::iterator it = stats.begin(); it != stats.end(); ++it) {
+		std::vector<std::uint64_t>& samples = it->second.replayNanoseconds;
+		std::uint64_t total = 0u;
+		for (std::uint64_t sample : samples)
+			total += sample;
+		std::sort(samples.begin(), samples.end());
+
+		Json::Value& native_json = natives_json[it->first];
+		native_json["calls"] = static_cast<Json::UInt64>(samples.size());
+		native_json["recordedMeanUs"] = it->second.recordedTotal / 1.0e3 / samples.size();
+		native_json["recordedMaxUs"] = it->second.recordedMax / 1.0e3;
+		native_json["replayMeanUs"] = total / 1.0e3 / samples.size();
+		native_json["replayP50Us"] = samples[samples.size() / 2u] / 1.0e3;
+		native_json["replayP99Us"] = samples[samples.size() * 99u / 100u] / 1.0e3;
+		native_json["replayMaxUs"] = samples.back() / 1.0e3;
+	}
+
+	Json::Value& skipped_json = report["skipped"];
+	skipped_json = Json::Value(Json::objectValue);
+	for (std::map<std::string, unsigned int>::iterator it = skipped.begin(); it != skipped.end(); ++it)
+		skipped_json[it->first] = it->second;
+
+	Json::StyledStreamWriter writer;
+	if (config.out.empty())
+		writer.write(std::cout, report);
+	else {
+		std::ofstream out_file(config.out);
+		writer.write(out_file, report);
+	}
+
+	return 0;
+}
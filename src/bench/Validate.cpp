@@ -0,0 +1,159 @@
+#include "core/CoreUtil.h"
+#include "core/OutfitPack.h"
+#include "core/Validation.h"
+#include "core/fake/FakeGameData.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+//Validates group files and outfit packs without the game, for CI over a modlist. Writes the JSON report and
+//exits with 2 if there are issues.
+//Usage: OutfitPlaylistValidate <group dir> [--plugins plugins.txt] [--out file]
+//Without a plugin list every referenced plugin counts as loaded. Forms in loaded plugins are
+//assumed to exist as outfit forms, so unresolved forms and wrong types are only found in game.
+
+using namespace OutfitPlaylist;
+
+struct ValidateConfig
+{
+	std::string dir;
+	std::string pluginsPath;
+	std::string out;
+};
+
+bool parseArgs(int argc, char** argv, ValidateConfig& config)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (!arg.starts_with("--")) {
+			config.dir = arg;
+			continue;
+		}
+
+		if (i + 1 >= argc) {
+			std::cerr << "Missing value for " << arg << std::endl;
+			return false;
+		}
+
+		std::string value = argv[++i];
+		if (arg == "--plugins")
+			config.pluginsPath = value;
+		else if (arg == "--out")
+			config.out = value;
+		else {
+			std::cerr << "Unknown argument " << arg << std::endl;
+			return false;
+		}
+	}
+
+	if (config.dir.empty()) {
+		std::cerr << "Usage: OutfitPlaylistValidate <group dir> [--plugins plugins.txt] [--out file]" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//plugins.txt format, one plugin per line with an optional '*' active marker and '#' comments
+bool readPluginList(const std::string& path, std::set<std::string>& plugins_out)
+{
+	std::ifstream plugins_file(path);
+	if (!plugins_file) {
+		std::cerr << "Unable to read plugin list " << path << std::endl;
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(plugins_file, line)) {
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		if (line.empty() || line[0] == '#')
+			continue;
+		if (line[0] == '*')
+			line.erase(0u, 1u);
+		plugins_out.insert(toLowercase(line));
+	}
+	return true;
+}
+
+//Registers every form the group files and packs reference from a loaded plugin
+void addGroupFileForms(const std::string& dir, const std::set<std::string>* plugins, FakeFormResolver& resolver)
+{
+	for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+		if (entry.path().extension() == OUTFIT_PACK_EXTENSION) {
+			std::vector<PackedGroup> groups;
+			readPackedGroups(entry.path().string(), groups);
+			for (const PackedGroup& group : groups) {
+				for (const PackedOutfit& outfit : group.outfits) {
+					for (const std::pair<std::string, FormID>& reference : outfit.forms) {
+						if (!plugins || plugins->contains(toLowercase(reference.first)))
+							resolver.addForm(reference.first, reference.second);
+					}
+				}
+			}
+			continue;
+		}
+		if (entry.path().extension() != ".json")
+			continue;
+
+		std::ifstream group_file(entry.path());
+		Json::Reader reader;
+		Json::Value group_json;
+		if (!reader.parse(group_file, group_json))
+			continue;
+
+		const Json::Value& outfits_json = group_json["outfits"];
+		for (Json::Value::const_iterator it = outfits_json.begin(); it != outfits_json.end(); ++it) {
+			for (unsigned int i = 0u; i < it->size(); i++) {
+				std::string mod_name;
+				FormID local_form_id;
+				if (!resolver.parseFormReference((*it)[i], mod_name, local_form_id))
+					continue;
+				if (plugins && !plugins->contains(toLowercase(mod_name)))
+					continue;
+
+				resolver.addForm(mod_name, local_form_id);
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ValidateConfig config;
+	if (!parseArgs(argc, argv, config))
+		return 1;
+
+	spdlog::set_default_logger(spdlog::stderr_color_mt("validate"));
+	spdlog::set_level(spdlog::level::warn);
+
+	std::set<std::string> plugins;
+	if (!config.pluginsPath.empty() && !readPluginList(config.pluginsPath, plugins))
+		return 1;
+
+	if (!std::filesystem::is_directory(config.dir)) {
+		std::cerr << "Group directory not found " << config.dir << std::endl;
+		return 1;
+	}
+
+	FakeFormResolver resolver;
+	SetFormResolver(&resolver);
+	addGroupFileForms(config.dir, config.pluginsPath.empty() ? NULL : &plugins, resolver);
+
+	Json::Value report;
+	unsigned int issues = ValidateGroupFiles(config.dir, report);
+
+	if (config.out.empty()) {
+		Json::StyledStreamWriter writer;
+		writer.write(std::cout, report);
+	}
+	else if (!writeValidationReport(config.out, report))
+		return 1;
+
+	std::cerr << report["groupFiles"].asUInt() << " group files and packs, " << report["groups"].asUInt() << " groups, " << report["outfits"].asUInt() << " outfits, " << issues << " issues" << std::endl;
+	return issues > 0u ? 2 : 0;
+}
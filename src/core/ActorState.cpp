@@ -0,0 +1,726 @@
+#include "ActorState.h"
+#include "CoreUtil.h"
+#include "LogCategories.h"
+#include "MemoryUsage.h"
+#include "PerfStats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+
+namespace OutfitPlaylist
+{
+	typedef std::map<FormID, Outfit> ActorOutfitMap;
+
+	//Recently worn outfits, oldest first until the ring wraps at next
+	struct OutfitHistory
+	{
+		IndexVec entries;
+		unsigned int next;
+		OutfitHistory();
+	};
+
+	typedef std::map<FormID, OutfitHistory> ActorHistoryMap;
+
+	//Encoded cosave entries for one actor, "key":value text reused until the actor changes
+	struct ActorSaveCache
+	{
+		std::string outfitJson;
+		std::string historyJson;
+		unsigned int historyVersion; //History is saved by name, so it's stale once the catalog changes
+		unsigned int lastTouchedSave;
+		unsigned int firstMissingSave; //0 while the actor resolves
+		bool dirty;
+		ActorSaveCache();
+	};
+
+	typedef std::map<FormID, ActorSaveCache> ActorSaveCacheMap;
+
+	//Per-actor state, sharded by form id so actors in different shards never contend
+	struct alignas(64) ActorShard
+	{
+		std::mutex mutex;
+		ActorOutfitMap equippedOutfits;
+		ActorHistoryMap outfitHistory;
+		ActorSaveCacheMap saveCache; //Every actor with state has an entry
+	};
+
+	const unsigned int ACTOR_SHARD_COUNT = 16u;
+	ActorShard sActorShards[ACTOR_SHARD_COUNT];
+
+	//Recent getActorOutfitInfo answers, one slot per actor hash. A slot is current while its generation
+	//and catalog version match, equipping, clearing, loading or pruning an actor bumps only its slot.
+	struct alignas(64) OutfitInfoSlot
+	{
+		std::atomic<unsigned int> generation;
+		std::mutex mutex;
+		FormID actorID;
+		unsigned int filledGeneration; //0 for never filled
+		unsigned int catalogVersion;
+		bool hasOutfit;
+		ActorOutfitInfo info;
+		OutfitInfoSlot();
+	};
+
+	const unsigned int OUTFIT_INFO_SLOT_COUNT = 64u;
+	OutfitInfoSlot sOutfitInfoSlots[OUTFIT_INFO_SLOT_COUNT];
+
+	//Stale actor pruning, generations count saves. Only changed while every shard is locked.
+	const unsigned int PRUNE_SHARDS_PER_SAVE = 4u; //Each actor is resolved once every 4 saves
+	unsigned int sSaveGeneration = 0u;
+	unsigned int sPruneShardCursor = 0u;
+	unsigned int sPruneMissingSaves = 5u;
+	unsigned int sMaxTrackedActors = 0u;
+
+	//Generation stamps for the history being tested, so clearing the marks is a counter bump
+	thread_local std::vector<unsigned int> tHistoryStamps;
+	thread_local unsigned int tHistoryGeneration = 0u;
+
+	//Version 1 records were written by SKSEUtil, version 2 records are the JSON text as is
+	const unsigned int SAVE_VERSION = 2u;
+	const std::uint32_t OutfitPlaylistRecord = 0x454C504F; //'OPLE' byte swapped
+
+	OutfitHistory::OutfitHistory()
+		: next(0u) {}
+
+	ActorSaveCache::ActorSaveCache()
+		: historyVersion(0u), lastTouchedSave(0u), firstMissingSave(0u), dirty(true) {}
+
+	ActorOutfitInfo::ActorOutfitInfo()
+		: index(-1), doNotRemove(false) {}
+
+	OutfitInfoSlot::OutfitInfoSlot()
+		: generation(1u), actorID(0u), filledGeneration(0u), catalogVersion(0u), hasOutfit(false) {}
+
+	ActorShard& getActorShard(FormID actor_id)
+	{
+		//The high byte is the load order index, fold it into the varied low bits
+		return sActorShards[(actor_id ^ (actor_id >> 24)) % ACTOR_SHARD_COUNT];
+	}
+
+	OutfitInfoSlot& getOutfitInfoSlot(FormID actor_id)
+	{
+		return sOutfitInfoSlots[(actor_id ^ (actor_id >> 24)) % OUTFIT_INFO_SLOT_COUNT];
+	}
+
+	void invalidateOutfitInfoSlot(OutfitInfoSlot& slot)
+	{
+		if (slot.generation.fetch_add(1u, std::memory_order_acq_rel) + 1u == 0u)
+			slot.generation.fetch_add(1u, std::memory_order_acq_rel); //0 marks empty slots
+	}
+
+	//Caller must hold the shard lock, after changing the actor's equipped outfit
+	void invalidateOutfitInfo(FormID actor_id)
+	{
+		invalidateOutfitInfoSlot(getOutfitInfoSlot(actor_id));
+	}
+
+	void clearActorState()
+	{
+		for (unsigned int i = 0u; i < ACTOR_SHARD_COUNT; i++) {
+			std::lock_guard<std::mutex> lock(sActorShards[i].mutex);
+			sActorShards[i].equippedOutfits.clear();
+			sActorShards[i].outfitHistory.clear();
+			sActorShards[i].saveCache.clear();
+		}
+		for (unsigned int i = 0u; i < OUTFIT_INFO_SLOT_COUNT; i++)
+			invalidateOutfitInfoSlot(sOutfitInfoSlots[i]);
+	}
+
+	//Caller must hold the shard lock
+	void markActorDirty(ActorShard& shard, FormID actor_id)
+	{
+		ActorSaveCache& cache = shard.saveCache[actor_id];
+		cache.dirty = true;
+		cache.lastTouchedSave = sSaveGeneration;
+	}
+
+	void configureActorPruning(const Json::Value& config_json)
+	{
+		std::unique_lock<std::mutex> locks[ACTOR_SHARD_COUNT];
+		for (unsigned int i = 0u; i < ACTOR_SHARD_COUNT; i++)
+			locks[i] = std::unique_lock<std::mutex>(sActorShards[i].mutex);
+
+		sPruneMissingSaves = config_json["pruneMissingActorSaves"].isUInt() ? config_json["pruneMissingActorSaves"].asUInt() : 5u;
+		//A soft limit, present actors are kept even when there are more
+		sMaxTrackedActors = config_json["maxTrackedActors"].isUInt() ? config_json["maxTrackedActors"].asUInt() : 0u;
+	}
+
+	//History
+
+	//Caller must hold the shard lock
+	void pushOutfitHistory(ActorShard& shard, FormID actor_id, unsigned int index, unsigned int window)
+	{
+		if (window == 0u)
+			return;
+
+		OutfitHistory& history = shard.outfitHistory[actor_id];
+		if (history.next != 0u && history.entries.size() != window) {
+			//The window changed after the ring wrapped, unwrap it oldest first before resizing
+			std::rotate(history.entries.begin(), history.entries.begin() + history.next, history.entries.end());
+			history.next = 0u;
+		}
+		if (history.entries.size() > window)
+			history.entries.erase(history.entries.begin(), history.entries.end() - window); //Keep the newest
+
+		if (history.entries.size() < window)
+			history.entries.push_back(index);
+		else {
+			history.entries[history.next] = index;
+			history.next = (history.next + 1u) % history.entries.size();
+		}
+	}
+
+	void markOutfitHistory(const OutfitCatalog& catalog, FormID actor_id)
+	{
+		tHistoryGeneration++;
+		if (tHistoryGeneration == 0u) {
+			std::fill(tHistoryStamps.begin(), tHistoryStamps.end(), 0u);
+			tHistoryGeneration = 1u;
+		}
+
+		if (tHistoryStamps.size() < catalog.outfits.size())
+			tHistoryStamps.resize(catalog.outfits.size(), 0u);
+
+		ActorShard& shard = getActorShard(actor_id);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		ActorHistoryMap::iterator it = shard.outfitHistory.find(actor_id);
+		if (it == shard.outfitHistory.end())
+			return;
+
+		//Only the newest entries if the window shrank since the actor's last push
+		const OutfitHistory& history = it->second;
+		std::size_t count = std::min<std::size_t>(history.entries.size(), catalog.historyWindow);
+		for (std::size_t i = history.entries.size() - count; i < history.entries.size(); i++) {
+			unsigned int index = history.entries[(history.next + i) % history.entries.size()];
+			if (index < tHistoryStamps.size())
+				tHistoryStamps[index] = tHistoryGeneration;
+		}
+	}
+
+	bool isInMarkedHistory(unsigned int index)
+	{
+		return index < tHistoryStamps.size() && tHistoryStamps[index] == tHistoryGeneration;
+	}
+
+	//Outfits
+
+	bool setActorOutfit(FormID actor_id, unsigned int index, bool do_not_remove, NativeFormArray* forms_out)
+	{
+		CatalogPtr catalog = materializeOutfit(index);
+		if (index < catalog->outfits.size()) {
+			const Outfit& outfit = catalog->outfits[index];
+
+			OPL_DEBUG(LogCategory::kOutfits, "Setting actor {} outfit to {}", formIDToString(actor_id), outfit.name);
+
+			ActorShard& shard = getActorShard(actor_id);
+			{
+				std::lock_guard<std::mutex> lock(shard.mutex);
+				//Only what the cosave needs, assigning into the old entry reuses its buffers
+				Outfit& equipped_outfit = shard.equippedOutfits[actor_id];
+				equipped_outfit.id = outfit.id;
+				equipped_outfit.name = outfit.name;
+				equipped_outfit.groupName = outfit.groupName;
+				equipped_outfit.forms = outfit.forms;
+				equipped_outfit.slotMask = outfit.slotMask;
+				equipped_outfit.weight = outfit.weight;
+				equipped_outfit.doNotRemove = do_not_remove;
+				pushOutfitHistory(shard, actor_id, index, catalog->historyWindow);
+				markActorDirty(shard, actor_id);
+				invalidateOutfitInfo(actor_id);
+			}
+
+			if (forms_out) {
+				const FormVec& equip_forms = getEquipForms(outfit);
+				forms_out->assign(equip_forms.begin(), equip_forms.end());
+			}
+			return true;
+		}
+
+		return false;
+	}
+
+	void clearActorOutfit(FormID actor_id, NativeFormArray* forms_out)
+	{
+		OPL_DEBUG(LogCategory::kOutfits, "Removing outfit from {}", formIDToString(actor_id));
+		ActorShard& shard = getActorShard(actor_id);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		ActorOutfitMap::iterator it = shard.equippedOutfits.find(actor_id);
+		if (it != shard.equippedOutfits.end()) {
+			if (forms_out) {
+				const FormVec& forms = it->second.forms;
+				forms_out->clear();
+				forms_out->reserve(forms.size() + (it->second.doNotRemove ? 1u : 0u));
+				if (it->second.doNotRemove)
+					forms_out->push_back(NULL);
+				forms_out->insert(forms_out->end(), forms.begin(), forms.end());
+			}
+
+			shard.equippedOutfits.erase(it);
+			markActorDirty(shard, actor_id);
+			invalidateOutfitInfo(actor_id);
+		}
+	}
+
+	bool getActorOutfit(FormID actor_id, Outfit& outfit_out)
+	{
+		ActorShard& shard = getActorShard(actor_id);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		ActorOutfitMap::iterator it = shard.equippedOutfits.find(actor_id);
+		if (it != shard.equippedOutfits.end()) {
+			outfit_out = it->second;
+			return true;
+		}
+
+		return false;
+	}
+
+	bool getActorOutfitInfo(FormID actor_id, ActorOutfitInfo& info_out)
+	{
+		//Read before the shard, an equip that lands in between leaves the slot already stale
+		OutfitInfoSlot& slot = getOutfitInfoSlot(actor_id);
+		unsigned int generation = slot.generation.load(std::memory_order_acquire);
+		CatalogPtr catalog = getCatalog();
+
+		{
+			std::lock_guard<std::mutex> lock(slot.mutex);
+			if (slot.actorID == actor_id && slot.filledGeneration == generation && slot.catalogVersion == catalog->version) {
+				incrementPerfCounter(kCounterOutfitInfoCacheHit);
+				if (slot.hasOutfit)
+					info_out = slot.info;
+				return slot.hasOutfit;
+			}
+		}
+
+		incrementPerfCounter(kCounterOutfitInfoCacheMiss);
+		bool has_outfit = false;
+		std::uint64_t outfit_id = 0u;
+		ActorOutfitInfo info;
+		{
+			ActorShard& shard = getActorShard(actor_id);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			ActorOutfitMap::const_iterator it = shard.equippedOutfits.find(actor_id);
+			if (it != shard.equippedOutfits.end()) {
+				info.name = it->second.name;
+				info.groupName = it->second.groupName;
+				info.doNotRemove = it->second.doNotRemove;
+				outfit_id = it->second.id;
+				has_outfit = true;
+			}
+		}
+
+		if (has_outfit)
+			info.index = findOutfitIndex(*catalog, outfit_id, info.groupName, info.name);
+
+		std::lock_guard<std::mutex> lock(slot.mutex);
+		slot.actorID = actor_id;
+		slot.filledGeneration = generation;
+		slot.catalogVersion = catalog->version;
+		slot.hasOutfit = has_outfit;
+		slot.info = info;
+		if (has_outfit)
+			info_out = info;
+		return has_outfit;
+	}
+
+	void clearActorHistory(FormID actor_id)
+	{
+		ActorShard& shard = getActorShard(actor_id);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		if (shard.outfitHistory.erase(actor_id) > 0u)
+			markActorDirty(shard, actor_id);
+	}
+
+	int getNonRepeatingOutfitIndex(const OutfitCatalog& catalog, FormID actor_id, const std::vector<std::string>& group_names, int shuffle_index, int seed)
+	{
+		if (shuffle_index < 0)
+			return -1;
+
+		//Playlist order is the group playlist, the catalog shuffle or the live outfits, the pointers keep them alive
+		PlaylistPtr playlist;
+		ShuffleCachePtr shuffled;
+		const IndexVec* order = &catalog.liveIndices;
+		if (!group_names.empty()) {
+			playlist = getGroupPlaylist(catalog, group_names, seed);
+			order = &playlist->outfitIndices;
+		}
+		else if (seed >= 0) {
+			shuffled = shuffleOutfits(catalog, seed);
+			order = &shuffled->indices;
+		}
+		std::size_t count = order->size();
+
+		if (count == 0u)
+			return -1;
+
+		markOutfitHistory(catalog, actor_id);
+
+		//At most window + 1 steps before reaching an outfit that isn't recent
+		unsigned int start = static_cast<unsigned int>(shuffle_index) % count;
+		std::size_t max_steps = std::min<std::size_t>(count, catalog.historyWindow + 1u);
+		for (std::size_t step = 0u; step < max_steps; step++) {
+			unsigned int position = static_cast<unsigned int>((start + step) % count);
+			unsigned int index = (*order)[position];
+			if (!isInMarkedHistory(index))
+				return static_cast<int>(index);
+		}
+
+		return static_cast<int>((*order)[start]);
+	}
+
+	//Group names are mostly shared with the catalog, they're counted once more here
+	void addActorMemoryUsage(MemoryUsage& usage)
+	{
+		SharedNameSet seen_names;
+		for (unsigned int i = 0u; i < ACTOR_SHARD_COUNT; i++) {
+			std::lock_guard<std::mutex> lock(sActorShards[i].mutex);
+			for (ActorOutfitMap::const_iterator it = sActorShards[i].equippedOutfits.begin(); it != sActorShards[i].equippedOutfits.end(); ++it) {
+				usage.actorState += MAP_NODE_OVERHEAD + sizeof(ActorOutfitMap::value_type) + getVectorHeapBytes(it->second.forms);
+				usage.actorState += getStringHeapBytes(it->second.name) + getSharedNameHeapBytes(it->second.groupName, seen_names);
+			}
+			for (ActorHistoryMap::const_iterator it = sActorShards[i].outfitHistory.begin(); it != sActorShards[i].outfitHistory.end(); ++it)
+				usage.actorState += MAP_NODE_OVERHEAD + sizeof(ActorHistoryMap::value_type) + getVectorHeapBytes(it->second.entries);
+			for (ActorSaveCacheMap::const_iterator it = sActorShards[i].saveCache.begin(); it != sActorShards[i].saveCache.end(); ++it)
+				usage.actorState += MAP_NODE_OVERHEAD + sizeof(ActorSaveCacheMap::value_type) + getStringHeapBytes(it->second.outfitJson) + getStringHeapBytes(it->second.historyJson);
+		}
+	}
+
+	//Cosave
+
+	bool readSaveJson(RecordSerializer& serde, std::uint32_t version, std::uint32_t length, Json::Value& save_json_out)
+	{
+		if (version < 2u)
+			return serde.readRecordJson(save_json_out);
+
+		std::string save_text;
+		if (!serde.readRecordData(save_text, length))
+			return false;
+
+		Json::Reader reader;
+		return reader.parse(save_text, save_json_out);
+	}
+
+	//Caller must hold the shard lock. Fills the actor's stale entries, each is a "key":value member.
+	void encodeActorSave(const ActorShard& shard, FormID actor_id, const OutfitCatalog& catalog, ActorSaveCache& cache)
+	{
+		FormResolver* resolver = getFormResolver();
+		std::string key = Json::valueToQuotedString(formIDToString(actor_id).c_str()) + ":";
+
+		Json::FastWriter writer;
+		writer.omitEndingLineFeed();
+
+		bool outfit_skipped = false; //Left out while the actor doesn't resolve, encoded again next save
+		if (cache.dirty) {
+			cache.outfitJson.clear();
+			ActorOutfitMap::const_iterator outfit_it = shard.equippedOutfits.find(actor_id);
+			if (outfit_it != shard.equippedOutfits.end() && !resolver->actorExists(actor_id))
+				outfit_skipped = true;
+			else if (outfit_it != shard.equippedOutfits.end()) {
+				const Outfit& outfit = outfit_it->second;
+
+				Json::Value actor_outfit_json;
+				actor_outfit_json["name"] = outfit.name;
+				actor_outfit_json["group"] = outfit.groupName.str();
+				actor_outfit_json["doNotRemove"] = outfit.doNotRemove;
+
+				if (!outfit.forms.empty()) {
+					Json::Value& forms_json = actor_outfit_json["forms"];
+					for (std::size_t i = 0u; i < outfit.forms.size(); i++)
+						forms_json.append(resolver->getFormID(outfit.forms[i]));
+				}
+
+				cache.outfitJson = key + writer.write(actor_outfit_json);
+				OPL_DEBUG(LogCategory::kSave, "Saved outfit for {:X}", actor_id);
+			}
+		}
+
+		if (cache.dirty || cache.historyVersion != catalog.version) {
+			cache.historyJson.clear();
+			cache.historyVersion = catalog.version;
+			ActorHistoryMap::const_iterator history_it = shard.outfitHistory.find(actor_id);
+			if (history_it != shard.outfitHistory.end() && !history_it->second.entries.empty()) {
+				const OutfitHistory& history = history_it->second;
+
+				Json::Value history_json(Json::arrayValue);
+				for (std::size_t i = 0u; i < history.entries.size(); i++) {
+					unsigned int index = history.entries[(history.next + i) % history.entries.size()];
+					if (index >= catalog.outfits.size())
+						continue;
+
+					Json::Value entry_json;
+					entry_json["group"] = catalog.outfits[index].groupName.str();
+					entry_json["name"] = catalog.outfits[index].name;
+					history_json.append(entry_json);
+				}
+				cache.historyJson = key + writer.write(history_json);
+			}
+		}
+
+		cache.dirty = outfit_skipped;
+	}
+
+	//Pruning, callers hold every shard lock
+
+	ActorSaveCacheMap::iterator evictActor(ActorShard& shard, ActorSaveCacheMap::iterator it)
+	{
+		OPL_DEBUG(LogCategory::kSave, "Pruning stale actor {:X}", it->first);
+		shard.equippedOutfits.erase(it->first);
+		shard.outfitHistory.erase(it->first);
+		invalidateOutfitInfo(it->first);
+		return shard.saveCache.erase(it);
+	}
+
+	//Resolves the actor and tracks since when it has been missing
+	ActorStatus updateActorStatus(FormID actor_id, ActorSaveCache& cache)
+	{
+		ActorStatus status = getFormResolver()->getActorStatus(actor_id);
+		if (status == kActorPresent) {
+			if (cache.firstMissingSave != 0u)
+				cache.dirty = true; //Its outfit may have been left out while it was missing
+			cache.firstMissingSave = 0u;
+		}
+		else if (status == kActorMissing && cache.firstMissingSave == 0u)
+			cache.firstMissingSave = sSaveGeneration;
+		return status;
+	}
+
+	//Deleted references go at once, missing actors once they have been missing for sPruneMissingSaves saves
+	bool isStaleActor(FormID actor_id, ActorSaveCache& cache)
+	{
+		ActorStatus status = updateActorStatus(actor_id, cache);
+		if (status == kActorDeleted)
+			return true;
+		return status == kActorMissing && sSaveGeneration - cache.firstMissingSave >= sPruneMissingSaves;
+	}
+
+	//Resolves the actors in this save's slice of shards, returns the number of actors left
+	unsigned int pruneStaleActors(unsigned int& pruned_out)
+	{
+		unsigned int actors = 0u;
+		for (unsigned int i = 0u; i < ACTOR_SHARD_COUNT; i++) {
+			ActorShard& shard = sActorShards[i];
+			bool check_shard = (i + ACTOR_SHARD_COUNT - sPruneShardCursor) % ACTOR_SHARD_COUNT < PRUNE_SHARDS_PER_SAVE;
+			if (!check_shard) {
+				actors += static_cast<unsigned int>(shard.saveCache.size());
+				continue;
+			}
+
+			ActorSaveCacheMap::iterator it = shard.saveCache.begin();
+			while (it != shard.saveCache.end()) {
+				if (isStaleActor(it->first, it->second)) {
+					it = evictActor(shard, it);
+					pruned_out++;
+				}
+				else {
+					actors++;
+					++it;
+				}
+			}
+		}
+
+		sPruneShardCursor = (sPruneShardCursor + PRUNE_SHARDS_PER_SAVE) % ACTOR_SHARD_COUNT;
+		return actors;
+	}
+
+	//Evicts actors that don't resolve now, those changed longest ago first, until the cap is met.
+	//Only this save's slice of shards was resolved, so every candidate is resolved again here.
+	//Present actors are never evicted, so the cap is a soft limit.
+	void capTrackedActors(unsigned int actors, unsigned int& pruned_out)
+	{
+		if (sMaxTrackedActors == 0u || actors <= sMaxTrackedActors)
+			return;
+
+		typedef std::pair<unsigned int, FormID> ActorAge;
+		std::vector<ActorAge> ages;
+		for (unsigned int i = 0u; i < ACTOR_SHARD_COUNT; i++) {
+			for (ActorSaveCacheMap::const_iterator it = sActorShards[i].saveCache.begin(); it != sActorShards[i].saveCache.end(); ++it)
+				ages.push_back(ActorAge(it->second.lastTouchedSave, it->first));
+		}
+		std::sort(ages.begin(), ages.end());
+
+		unsigned int evict_count = actors - sMaxTrackedActors;
+		for (std::size_t i = 0u; i < ages.size() && evict_count > 0u; i++) {
+			ActorShard& shard = getActorShard(ages[i].second);
+			ActorSaveCacheMap::iterator it = shard.saveCache.find(ages[i].second);
+			if (updateActorStatus(it->first, it->second) == kActorPresent)
+				continue;
+
+			evictActor(shard, it);
+			evict_count--;
+			pruned_out++;
+		}
+	}
+
+	void appendSaveMember(std::string& members, const std::string& member)
+	{
+		if (member.empty())
+			return;
+		if (!members.empty())
+			members += ',';
+		members += member;
+	}
+
+	void loadActorState(RecordSerializer& serde)
+	{
+		FormResolver* resolver = getFormResolver();
+		CatalogPtr catalog = getCatalog();
+
+		std::uint32_t type;
+		std::uint32_t size;
+		std::uint32_t version;
+		while (serde.getNextRecordInfo(type, version, size))
+		{
+			if (type == OutfitPlaylistRecord) {
+
+				Json::Value save_json;
+				if (readSaveJson(serde, version, size, save_json) && save_json.isObject()) {
+					OPL_INFO(LogCategory::kSave, "Reading saved actor outfits");
+
+					Json::Value& actor_outfits_json = save_json["actorOutfits"];
+					for (Json::ValueIterator it = actor_outfits_json.begin(); it != actor_outfits_json.end(); ++it)
+					{
+						FormID actor_form_id = stringToFormID(it.key().asString());
+						if (!serde.resolveFormID(actor_form_id, actor_form_id)) {
+							spdlog::error("Failed to resolve actor FormID {:X}", actor_form_id);
+							continue;
+						}
+
+						if (!resolver->actorExists(actor_form_id)) {
+							spdlog::error("Actor not found {:X}", actor_form_id);
+							continue;
+						}
+
+						Outfit outfit;
+						std::string group_name;
+						tryGetString((*it)["name"], outfit.name);
+						tryGetString((*it)["group"], group_name);
+						outfit.id = getOutfitID(group_name, outfit.name);
+
+						//Share the loaded group's name when there is one
+						OutfitGroupMap::const_iterator group_it = catalog->groups.find(group_name);
+						outfit.groupName = group_it != catalog->groups.end() ? group_it->second.name : SharedName(group_name);
+						tryGetBool((*it)["doNotRemove"], outfit.doNotRemove);
+						Json::Value& forms_json = (*it)["forms"];
+
+						for (unsigned int i = 0u; i < forms_json.size(); i++) {
+							FormID form_id = forms_json[i].asUInt();
+							if (!serde.resolveFormID(form_id, form_id)) {
+								spdlog::error("Failed to resolve FormID {:X}", form_id);
+								continue;
+							}
+
+							GameForm* form = resolver->lookupForm(form_id);
+							if (form)
+								outfit.forms.push_back(form);
+							else
+								spdlog::error("Outfit form not found {:X}", form_id);
+						}
+
+						if (!outfit.name.empty() && !outfit.groupName.empty()) {
+							ActorShard& shard = getActorShard(actor_form_id);
+							std::lock_guard<std::mutex> lock(shard.mutex);
+							shard.equippedOutfits[actor_form_id] = outfit;
+							markActorDirty(shard, actor_form_id);
+							invalidateOutfitInfo(actor_form_id);
+							OPL_DEBUG(LogCategory::kSave, "Loaded outfit for {:X}", actor_form_id);
+						}
+						else {
+							spdlog::warn("Invalid outfit save for {:X}", actor_form_id);
+						}
+					}
+
+					//Outfit history is saved by name since indices depend on the catalog
+					Json::Value& actor_history_json = save_json["actorHistory"];
+					for (Json::ValueIterator it = actor_history_json.begin(); it != actor_history_json.end(); ++it)
+					{
+						FormID actor_form_id = stringToFormID(it.key().asString());
+						if (!serde.resolveFormID(actor_form_id, actor_form_id))
+							continue;
+
+						ActorShard& shard = getActorShard(actor_form_id);
+						std::lock_guard<std::mutex> lock(shard.mutex);
+
+						unsigned int first = it->size() > catalog->historyWindow ? it->size() - catalog->historyWindow : 0u;
+						for (unsigned int i = first; i < it->size(); i++) {
+							std::string group_name = (*it)[i]["group"].asString();
+							std::string outfit_name = (*it)[i]["name"].asString();
+							int outfit_index = findOutfitIndex(*catalog, getOutfitID(group_name, outfit_name), group_name, outfit_name);
+							if (outfit_index >= 0)
+								pushOutfitHistory(shard, actor_form_id, static_cast<unsigned int>(outfit_index), catalog->historyWindow);
+						}
+						markActorDirty(shard, actor_form_id);
+					}
+				}
+				else
+					OPL_INFO(LogCategory::kSave, "No save JSON");
+			}
+		}
+	}
+
+	void saveActorState(RecordSerializer& serde)
+	{
+		CatalogPtr catalog = getCatalog();
+
+		std::string outfits_text;
+		std::string history_text;
+		unsigned int encoded = 0u;
+		unsigned int actors = 0u;
+		unsigned int pruned = 0u;
+		{
+			//All shard locks, so the record is a single point in time
+			std::unique_lock<std::mutex> locks[ACTOR_SHARD_COUNT];
+			for (unsigned int i = 0u; i < ACTOR_SHARD_COUNT; i++)
+				locks[i] = std::unique_lock<std::mutex>(sActorShards[i].mutex);
+
+			sSaveGeneration++;
+			capTrackedActors(pruneStaleActors(pruned), pruned);
+
+			for (unsigned int i = 0u; i < ACTOR_SHARD_COUNT; i++) {
+				ActorShard& shard = sActorShards[i];
+				ActorSaveCacheMap::iterator it = shard.saveCache.begin();
+				while (it != shard.saveCache.end()) {
+					if (it->second.dirty || it->second.historyVersion != catalog->version) {
+						encodeActorSave(shard, it->first, *catalog, it->second);
+						encoded++;
+					}
+
+					if (it->second.outfitJson.empty() && it->second.historyJson.empty() &&
+						shard.equippedOutfits.find(it->first) == shard.equippedOutfits.end() && shard.outfitHistory.find(it->first) == shard.outfitHistory.end()) {
+						it = shard.saveCache.erase(it);
+						continue;
+					}
+
+					appendSaveMember(outfits_text, it->second.outfitJson);
+					appendSaveMember(history_text, it->second.historyJson);
+					actors++;
+					++it;
+				}
+			}
+		}
+
+		if (pruned > 0u)
+			OPL_INFO(LogCategory::kSave, "Pruned {} stale actors", pruned);
+
+		if (outfits_text.empty() && history_text.empty())
+			return;
+
+		if (!serde.openRecord(OutfitPlaylistRecord, SAVE_VERSION)) {
+			spdlog::error("Unable to open record to write cosave data.");
+			return;
+		}
+
+		OPL_INFO(LogCategory::kSave, "Saving actor outfits, {} of {} actors re-encoded", encoded, actors);
+
+		std::string save_text;
+		save_text.reserve(outfits_text.size() + history_text.size() + 40u);
+		save_text += "{\"actorHistory\":{";
+		save_text += history_text;
+		save_text += "},\"actorOutfits\":{";
+		save_text += outfits_text;
+		save_text += "}}";
+
+		if (!serde.writeRecordData(save_text))
+			spdlog::error("Unable to write cosave data.");
+	}
+}
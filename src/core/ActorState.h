@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Catalog.h"
+#include "ScratchAllocator.h"
+
+namespace OutfitPlaylist
+{
+	//Per-actor equipped outfits and outfit history, safe to call from any thread
+
+	void clearActorState();
+
+	//Actors missing for "pruneMissingActorSaves" saves or deleted are dropped at save time.
+	//"maxTrackedActors" is a soft limit (0 for none, the default): beyond it, actors that don't resolve
+	//go early, longest unchanged first, but actors in the game are kept however many there are.
+	void configureActorPruning(const Json::Value& config_json);
+
+	bool setActorOutfit(FormID actor_id, unsigned int index, bool do_not_remove, NativeFormArray* forms_out = NULL);
+
+	//forms_out starts with a NULL entry if the outfit's forms shouldn't be removed
+	void clearActorOutfit(FormID actor_id, NativeFormArray* forms_out = NULL);
+
+	//Copies the outfit out, the shard entry can change as soon as the lock is released
+	bool getActorOutfit(FormID actor_id, Outfit& outfit_out);
+
+	//What scripts ask about an actor's equipped outfit, index is -1 once the outfit left the catalog
+	struct ActorOutfitInfo
+	{
+		std::string name;
+		std::string groupName;
+		int index;
+		bool doNotRemove;
+		ActorOutfitInfo();
+	};
+
+	//Answered from a small per-actor cache until the actor's outfit or the catalog changes
+	bool getActorOutfitInfo(FormID actor_id, ActorOutfitInfo& info_out);
+
+	void clearActorHistory(FormID actor_id);
+
+	//Walks the group playlist (or catalog shuffle) from shuffle_index, skipping the actor's recent outfits
+	int getNonRepeatingOutfitIndex(const OutfitCatalog& catalog, FormID actor_id, const std::vector<std::string>& group_names, int shuffle_index, int seed);
+
+	void addActorMemoryUsage(MemoryUsage& usage);
+
+	//Cosave
+	void loadActorState(RecordSerializer& serde);
+	void saveActorState(RecordSerializer& serde);
+}
@@ -0,0 +1,301 @@
+#include "CallTrace.h"
+#include "LogCategories.h"
+
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+namespace OutfitPlaylist
+{
+	const char TRACE_MAGIC[4] = { 'O', 'P', 'L', 'T' };
+	const std::uint32_t TRACE_VERSION = 1u;
+	const std::size_t TRACE_FLUSH_SIZE = 64u * 1024u;
+
+	std::atomic<bool> sCallTraceActive(false);
+
+	std::mutex sTraceMutex;
+	std::ofstream sTraceFile;
+	std::string sTracePath;
+	std::string sTraceBuffer;
+	std::chrono::steady_clock::time_point sTraceStart;
+
+	template <class T>
+	void appendTraceValue(std::string& out, T value)
+	{
+		char bytes[sizeof(T)];
+		std::memcpy(bytes, &value, sizeof(T));
+		out.append(bytes, sizeof(T));
+	}
+
+	void appendTraceString(std::string& out, const std::string& value)
+	{
+		std::uint16_t length = static_cast<std::uint16_t>(std::min<std::size_t>(value.size(), 0xFFFFu));
+		appendTraceValue(out, length);
+		out.append(value.data(), length);
+	}
+
+	//Caller must hold sTraceMutex
+	void writeTraceBuffer()
+	{
+		if (sTraceBuffer.empty())
+			return;
+		sTraceFile.write(sTraceBuffer.data(), sTraceBuffer.size());
+		sTraceFile.flush();
+		sTraceBuffer.clear();
+	}
+
+	bool StartCallTrace(const std::string& path)
+	{
+		std::lock_guard<std::mutex> lock(sTraceMutex);
+		if (sTraceFile.is_open()) {
+			if (sTracePath == path)
+				return true;
+			writeTraceBuffer();
+			sTraceFile.close();
+		}
+
+		sTraceFile.open(path, std::ios::binary | std::ios::trunc);
+		if (!sTraceFile.is_open()) {
+			spdlog::error("Unable to open native call trace {}", path);
+			sCallTraceActive.store(false);
+			return false;
+		}
+
+		sTracePath = path;
+		sTraceBuffer.clear();
+		sTraceBuffer.reserve(TRACE_FLUSH_SIZE * 2u);
+		sTraceBuffer.append(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+		appendTraceValue(sTraceBuffer, TRACE_VERSION);
+		appendTraceValue(sTraceBuffer, static_cast<std::uint16_t>(kPerfNumStats));
+		for (unsigned int i = 0u; i < kPerfNumStats; i++) {
+			const char* name = getPerfStatName(static_cast<PerfStat>(i));
+			std::uint8_t length = static_cast<std::uint8_t>(std::strlen(name));
+			appendTraceValue(sTraceBuffer, length);
+			sTraceBuffer.append(name, length);
+		}
+		writeTraceBuffer();
+
+		sTraceStart = std::chrono::steady_clock::now();
+		sCallTraceActive.store(true);
+		OPL_INFO(LogCategory::kPerf, "Tracing native calls to {}", path);
+		return true;
+	}
+
+	void StopCallTrace()
+	{
+		sCallTraceActive.store(false);
+
+		std::lock_guard<std::mutex> lock(sTraceMutex);
+		if (!sTraceFile.is_open())
+			return;
+
+		writeTraceBuffer();
+		sTraceFile.close();
+		sTracePath.clear();
+	}
+
+	void flushCallTrace()
+	{
+		std::lock_guard<std::mutex> lock(sTraceMutex);
+		if (sTraceFile.is_open())
+			writeTraceBuffer();
+	}
+
+	void TracedCall::encodeArg(int value)
+	{
+		argData.push_back(static_cast<char>(kTraceInt));
+		appendTraceValue(argData, static_cast<std::int32_t>(value));
+		argCount++;
+	}
+
+	void TracedCall::encodeArg(bool value)
+	{
+		argData.push_back(static_cast<char>(kTraceBool));
+		argData.push_back(value ? 1 : 0);
+		argCount++;
+	}
+
+	void TracedCall::encodeArg(const std::string& value)
+	{
+		argData.push_back(static_cast<char>(kTraceString));
+		appendTraceString(argData, value);
+		argCount++;
+	}
+
+	void TracedCall::encodeArg(const std::vector<std::string>& value)
+	{
+		argData.push_back(static_cast<char>(kTraceStringArray));
+		std::uint16_t count = static_cast<std::uint16_t>(std::min<std::size_t>(value.size(), 0xFFFFu));
+		appendTraceValue(argData, count);
+		for (std::uint16_t i = 0u; i < count; i++)
+			appendTraceString(argData, value[i]);
+		argCount++;
+	}
+
+	void TracedCall::encodeArg(const TraceForm& value)
+	{
+		argData.push_back(static_cast<char>(kTraceForm));
+		appendTraceValue(argData, static_cast<std::uint32_t>(value.formID));
+		argCount++;
+	}
+
+	TracedCall::~TracedCall()
+	{
+		if (!active)
+			return;
+
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		std::lock_guard<std::mutex> lock(sTraceMutex);
+		if (!sTraceFile.is_open())
+			return; //Stopped mid call
+
+		std::uint64_t start_ns = start > sTraceStart ? std::chrono::duration_cast<std::chrono::nanoseconds>(start - sTraceStart).count() : 0u;
+		std::uint64_t duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+		appendTraceValue(sTraceBuffer, static_cast<std::uint16_t>(stat));
+		appendTraceValue(sTraceBuffer, start_ns);
+		appendTraceValue(sTraceBuffer, static_cast<std::uint32_t>(std::min<std::uint64_t>(duration_ns, 0xFFFFFFFFu)));
+		appendTraceValue(sTraceBuffer, argCount);
+		sTraceBuffer.append(argData);
+
+		if (sTraceBuffer.size() >= TRACE_FLUSH_SIZE)
+			writeTraceBuffer();
+	}
+
+	//Reading
+
+	class TraceReader
+	{
+	public:
+		TraceReader(const std::string& trace_data) : data(trace_data), offset(0u) {}
+
+		template <class T>
+		bool read(T& value_out)
+		{
+			if (offset + sizeof(T) > data.size())
+				return false;
+			std::memcpy(&value_out, data.data() + offset, sizeof(T));
+			offset += sizeof(T);
+			return true;
+		}
+
+		bool readBytes(std::size_t length, std::string& out)
+		{
+			if (offset + length > data.size())
+				return false;
+			out.assign(data, offset, length);
+			offset += length;
+			return true;
+		}
+
+		bool readString(std::string& out)
+		{
+			std::uint16_t length;
+			return read(length) && readBytes(length, out);
+		}
+
+		bool atEnd() const { return offset >= data.size(); }
+
+	private:
+		const std::string& data;
+		std::size_t offset;
+	};
+
+	bool readTraceArg(TraceReader& reader, TraceArg& arg_out)
+	{
+		std::uint8_t type;
+		if (!reader.read(type))
+			return false;
+
+		arg_out.type = static_cast<TraceArgType>(type);
+		arg_out.intValue = 0;
+
+		switch (arg_out.type) {
+		case kTraceInt:
+			return reader.read(arg_out.intValue);
+		case kTraceBool: {
+			std::uint8_t value;
+			if (!reader.read(value))
+				return false;
+			arg_out.intValue = value;
+			return true;
+		}
+		case kTraceForm: {
+			std::uint32_t value;
+			if (!reader.read(value))
+				return false;
+			arg_out.intValue = static_cast<std::int32_t>(value);
+			return true;
+		}
+		case kTraceString:
+			return reader.readString(arg_out.stringValue);
+		case kTraceStringArray: {
+			std::uint16_t count;
+			if (!reader.read(count))
+				return false;
+			arg_out.stringArray.resize(count);
+			for (std::string& value : arg_out.stringArray) {
+				if (!reader.readString(value))
+					return false;
+			}
+			return true;
+		}
+		}
+		return false;
+	}
+
+	bool readCallTrace(const std::string& path, std::vector<TraceCall>& calls_out)
+	{
+		std::ifstream trace_file(path, std::ios::binary);
+		if (!trace_file.is_open()) {
+			spdlog::error("Unable to open native call trace {}", path);
+			return false;
+		}
+
+		std::string data((std::istreambuf_iterator<char>(trace_file)), std::istreambuf_iterator<char>());
+		TraceReader reader(data);
+
+		std::string magic;
+		std::uint32_t version;
+		std::uint16_t native_count;
+		if (!reader.readBytes(sizeof(TRACE_MAGIC), magic) || magic.compare(0u, sizeof(TRACE_MAGIC), TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+			!reader.read(version) || version != TRACE_VERSION || !reader.read(native_count)) {
+			spdlog::error("Invalid native call trace {}", path);
+			return false;
+		}
+
+		//Natives are named in the header so traces outlive changes to the PerfStat order
+		std::vector<std::string> native_names(native_count);
+		for (std::uint16_t i = 0u; i < native_count; i++) {
+			std::uint8_t length;
+			if (!reader.read(length) || !reader.readBytes(length, native_names[i])) {
+				spdlog::error("Invalid native call trace header {}", path);
+				return false;
+			}
+		}
+
+		while (!reader.atEnd()) {
+			std::uint16_t native;
+			std::uint8_t arg_count;
+			TraceCall call;
+			if (!reader.read(native) || !reader.read(call.startNanoseconds) || !reader.read(call.durationNanoseconds) || !reader.read(arg_count) || native >= native_count) {
+				spdlog::warn("Native call trace {} is truncated after {} calls", path, calls_out.size());
+				return true; //Keep what was read, the game may have closed mid write
+			}
+
+			call.native = native_names[native];
+			call.args.resize(arg_count);
+			for (TraceArg& arg : call.args) {
+				if (!readTraceArg(reader, arg)) {
+					spdlog::warn("Native call trace {} is truncated after {} calls", path, calls_out.size());
+					return true;
+				}
+			}
+
+			calls_out.push_back(std::move(call));
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "GameData.h"
+#include "PerfStats.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace OutfitPlaylist
+{
+	//Opt-in binary trace of native calls, replayed offline against the core.
+	//Layout: "OPLT", u32 version, u16 native count, then a u8 length prefixed name per native.
+	//Each call is u16 native, u64 start ns since the trace started, u32 duration ns, u8 argument
+	//count and the arguments, each a TraceArgType tag followed by its value. Little endian.
+
+	enum TraceArgType : std::uint8_t
+	{
+		kTraceInt = 'i', //i32
+		kTraceBool = 'b', //u8
+		kTraceString = 's', //u16 length, bytes
+		kTraceStringArray = 'v', //u16 count, strings
+		kTraceForm = 'a' //u32 form id
+	};
+
+	//Marks a form id argument, so it isn't recorded as a plain int
+	struct TraceForm
+	{
+		FormID formID;
+		explicit TraceForm(FormID form_id) : formID(form_id) {}
+	};
+
+	struct TraceArg
+	{
+		TraceArgType type;
+		std::int32_t intValue;
+		std::string stringValue;
+		std::vector<std::string> stringArray;
+	};
+
+	struct TraceCall
+	{
+		std::string native;
+		std::uint64_t startNanoseconds;
+		std::uint32_t durationNanoseconds;
+		std::vector<TraceArg> args;
+	};
+
+	extern std::atomic<bool> sCallTraceActive;
+
+	inline bool isCallTraceActive()
+	{
+		return sCallTraceActive.load(std::memory_order_relaxed);
+	}
+
+	//Starting an already running trace on the same file keeps it going
+	bool StartCallTrace(const std::string& path);
+	void StopCallTrace();
+	void flushCallTrace();
+
+	bool readCallTrace(const std::string& path, std::vector<TraceCall>& calls_out);
+
+	//Records the call and its arguments for the lifetime of the enclosing scope, costs a load when tracing is off
+	class TracedCall
+	{
+	public:
+		template <class... Args>
+		TracedCall(PerfStat stat, const Args&... args)
+			: stat(stat), active(isCallTraceActive())
+		{
+			if (!active)
+				return;
+			argCount = 0u;
+			(encodeArg(args), ...);
+			start = std::chrono::steady_clock::now();
+		}
+
+		~TracedCall();
+
+	private:
+		void encodeArg(int value);
+		void encodeArg(bool value);
+		void encodeArg(const std::string& value);
+		void encodeArg(const std::vector<std::string>& value);
+		void encodeArg(const TraceForm& value);
+
+		PerfStat stat;
+		bool active;
+		std::uint8_t argCount;
+		std::string argData;
+		std::chrono::steady_clock::time_point start;
+	};
+}
@@ -0,0 +1,1334 @@
+#include "Catalog.h"
+#include "ContextRules.h"
+#include "CoreUtil.h"
+#include "FormFilter.h"
+#include "LogCategories.h"
+#include "MemoryUsage.h"
+#include "OutfitPack.h"
+#include "PerfStats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <random>
+#include <unordered_set>
+
+namespace OutfitPlaylist
+{
+	typedef std::shared_ptr<OutfitCatalog> MutableCatalogPtr;
+
+	FormResolver* sFormResolver = NULL;
+
+	std::atomic<CatalogPtr> sCatalog(std::make_shared<const OutfitCatalog>());
+	std::mutex sCatalogWriteMutex; //Serializes writers, readers never take it
+	unsigned int sCatalogVersion = 0u;
+	std::vector<std::uint64_t> sChangedOutfitIDs; //Outfits changed since the copy, their layered dependents are flattened on publish
+
+	std::atomic<ShuffleCachePtr> sShuffleCache;
+
+	//Playlists are evicted least recently used first
+	typedef std::list<std::string> PlaylistKeyList;
+
+	struct CachedPlaylist
+	{
+		PlaylistPtr playlist;
+		PlaylistKeyList::iterator recentIt;
+	};
+
+	typedef std::unordered_map<std::string, CachedPlaylist> GroupPlaylistMap;
+	GroupPlaylistMap sGroupPlaylists;
+	PlaylistKeyList sRecentPlaylists; //Most recently used first
+	std::mutex sPlaylistMutex;
+
+	const std::size_t MAX_GROUP_PLAYLISTS = 64u;
+
+	//Group set key scratch, reused so cache hits don't allocate
+	thread_local std::vector<const std::string*> tPlaylistGroupNames;
+	thread_local std::string tPlaylistKey;
+
+	Outfit::Outfit()
+		: id(0u), slotMask(0u), weight(1.0f), doNotRemove(false) {}
+
+	OutfitGroup::OutfitGroup()
+		: weight(1.0f), loaded(true) {}
+
+	OutfitCatalog::OutfitCatalog()
+		: historyWindow(3u), version(0u), lazyGroupLoading(false) {}
+
+	void SetFormResolver(FormResolver* resolver)
+	{
+		sFormResolver = resolver;
+	}
+
+	FormResolver* getFormResolver()
+	{
+		return sFormResolver;
+	}
+
+	//Catalog
+	CatalogPtr getCatalog()
+	{
+		return sCatalog.load();
+	}
+
+	//Caller must hold sCatalogWriteMutex until the copy is published
+	MutableCatalogPtr copyCatalog()
+	{
+		sChangedOutfitIDs.clear(); //Left by a writer that gave up its copy
+		return std::make_shared<OutfitCatalog>(*sCatalog.load());
+	}
+
+	void buildAliasTable(const OutfitCatalog& catalog, AliasTable& table, const IndexVec& outfit_indices, bool use_group_weights);
+	void addLayerDependents(OutfitCatalog& catalog, unsigned int index);
+
+	float readWeight(const Json::Value& json, const std::string& context)
+	{
+		if (json.isNull())
+			return 1.0f;
+		if (!json.isNumeric() || json.asFloat() < 0.0f) {
+			spdlog::error("Invalid weight for {}", context);
+			return 0.0f;
+		}
+		return json.asFloat();
+	}
+
+	//Parse a group file into detached outfits, the caller assigns outfit indices.
+	//Without resolve_forms only names and weights are kept and the forms are left empty, the
+	//file is still parsed whole since outfit names are needed for stable indices. Otherwise the
+	//resolved forms still have to go through prepareLoadedGroups.
+	bool readGroupFile(const std::string& path, LoadedGroup& loaded_out, bool resolve_forms, FormRejections& rejections)
+	{
+		OPL_INFO(LogCategory::kGroups, "Reading outfit group file {}", path);
+		std::ifstream group_file(path);
+
+		Json::Reader reader;
+		Json::Value group_json;
+		reader.parse(group_file, group_json);
+
+		Json::Value outfits_json = group_json["outfits"];
+		if (!outfits_json.isObject()) {
+			spdlog::error("Invalid group file JSON {}", path);
+			return false;
+		}
+
+		OutfitGroup& group_out = loaded_out.group;
+		std::vector<Outfit>& outfits_out = loaded_out.outfits;
+		group_out.name = SharedName(std::filesystem::path(path).filename().replace_extension("").string());
+		group_out.weight = readWeight(group_json["weight"], group_out.name);
+		group_out.loaded = resolve_forms;
+		outfits_out.reserve(outfits_json.size());
+
+		const Json::Value& weights_json = group_json["weights"];
+		const Json::Value& layers_json = group_json["layers"];
+		NameTable layer_names; //Many outfits are built on the same few
+
+		for (Json::Value::iterator it = outfits_json.begin(); it != outfits_json.end(); ++it) {
+			if (!it->isArray()) {
+				spdlog::error("Invalid outfit JSON {}", it.key().asString());
+				continue;
+			}
+
+			outfits_out.push_back(Outfit());
+			Outfit& outfit = outfits_out.back();
+			outfit.name = it.key().asString();
+			outfit.groupName = group_out.name;
+			outfit.id = getOutfitID(outfit.groupName, outfit.name);
+			outfit.weight = weights_json.isObject() ? readWeight(weights_json[outfit.name], outfit.name) : 1.0f;
+			if (!resolve_forms)
+				continue;
+
+			outfit.forms.reserve(it->size());
+
+			//Form types are checked for the whole load at once
+			for (unsigned int i = 0u; i < it->size(); i++) {
+				GameForm* form = NULL;
+				if (!sFormResolver->deserializeForm((*it)[i], form))
+					addFormRejection(rejections, kRejectInvalid, outfit, (*it)[i].asString());
+				else if (!form)
+					addFormRejection(rejections, kRejectNotFound, outfit, (*it)[i].asString());
+				else
+					outfit.forms.push_back(form);
+			}
+
+			const Json::Value& outfit_layers_json = layers_json.isObject() ? layers_json[outfit.name] : Json::Value::nullSingleton();
+			for (unsigned int i = 0u; outfit_layers_json.isArray() && i < outfit_layers_json.size(); i++) {
+				if (outfit_layers_json[i].isString())
+					outfit.layers.push_back(layer_names.intern(outfit_layers_json[i].asString()));
+				else
+					spdlog::error("Invalid outfit layer: {}", outfit.name);
+			}
+		}
+
+		return true;
+	}
+
+	//Filters the resolved forms of every group in one batch, then puts them into equip order
+	void prepareLoadedGroups(std::vector<LoadedGroup>& loaded_groups, FormRejections& rejections, const std::string& context)
+	{
+		std::vector<Outfit*> outfits;
+		for (LoadedGroup& loaded_group : loaded_groups) {
+			if (!loaded_group.group.loaded)
+				continue;
+			for (Outfit& outfit : loaded_group.outfits)
+				outfits.push_back(&outfit);
+		}
+
+		filterOutfitForms(outfits, rejections);
+
+		for (Outfit* outfit : outfits) {
+			//Layered outfits are flattened into forms when the catalog is published
+			if (!outfit->layers.empty())
+				outfit->ownForms.swap(outfit->forms);
+			else
+				prepareOutfitForms(*outfit, true);
+		}
+
+		logFormRejections(rejections, context);
+	}
+
+	//Only if the id is the outfit's, another outfit may hold it after a failed addOutfitID
+	void removeOutfitID(OutfitCatalog& catalog, unsigned int index)
+	{
+		OutfitIDMap::iterator id_it = catalog.idIndices.find(catalog.outfits[index].id);
+		if (id_it != catalog.idIndices.end() && id_it->second == index)
+			catalog.idIndices.erase(id_it);
+	}
+
+	//Outfits removed by a reload keep their slot so existing indices stay valid
+	void tombstoneOutfit(OutfitCatalog& catalog, unsigned int index)
+	{
+		sChangedOutfitIDs.push_back(catalog.outfits[index].id);
+		removeOutfitID(catalog, index);
+		catalog.outfits[index].groupName.clear();
+		catalog.outfits[index].forms.clear();
+		catalog.outfits[index].layers.clear();
+		catalog.outfits[index].ownForms.clear();
+		catalog.outfits[index].equipForms.clear();
+		catalog.outfits[index].weight = 0.0f;
+	}
+
+	//Caller must hold sCatalogWriteMutex
+	void addOutfitID(OutfitCatalog& catalog, unsigned int index)
+	{
+		const Outfit& outfit = catalog.outfits[index];
+		std::pair<OutfitIDMap::iterator, bool> id_it = catalog.idIndices.insert(OutfitIDMap::value_type(outfit.id, index));
+		if (!id_it.second && id_it.first->second != index)
+			spdlog::error("Outfit id {} of {}:{} is already used by {}", outfitIDToString(outfit.id), outfit.groupName, outfit.name, catalog.outfits[id_it.first->second].name);
+	}
+
+	//Replace a group's outfits with a freshly read version, outfits that keep their id keep their index
+	OutfitGroup& applyGroupFile(OutfitCatalog& catalog, LoadedGroup& loaded)
+	{
+		const OutfitGroup& loaded_group = loaded.group;
+		std::vector<Outfit>& outfits = loaded.outfits;
+		OutfitGroup& group = catalog.groups[loaded_group.name];
+		group.name = loaded_group.name;
+		group.weight = loaded_group.weight;
+		group.loaded = loaded_group.loaded;
+		group.packFile = loaded_group.packFile;
+
+		IndexVec old_indices;
+		old_indices.swap(group.outfitIndices);
+		group.outfitIndices.reserve(outfits.size());
+
+		//Names that only differ in case share an id, only the first one can take over a slot
+		std::unordered_set<std::uint64_t> applied_ids;
+		for (Outfit& outfit : outfits) {
+			sChangedOutfitIDs.push_back(outfit.id);
+			OutfitIDMap::const_iterator id_it = catalog.idIndices.find(outfit.id);
+			bool first_with_id = applied_ids.insert(outfit.id).second;
+			if (first_with_id && id_it != catalog.idIndices.end() && catalog.outfits[id_it->second].groupName == group.name) {
+				group.outfitIndices.push_back(id_it->second);
+				catalog.outfits[id_it->second] = std::move(outfit);
+			}
+			else {
+				group.outfitIndices.push_back(catalog.outfits.size());
+				catalog.outfits.push_back(std::move(outfit));
+				addOutfitID(catalog, group.outfitIndices.back());
+			}
+		}
+
+		IndexVec kept_indices = group.outfitIndices;
+		std::sort(kept_indices.begin(), kept_indices.end());
+		for (unsigned int index : old_indices) {
+			if (!std::binary_search(kept_indices.begin(), kept_indices.end(), index))
+				tombstoneOutfit(catalog, index);
+		}
+
+		for (unsigned int index : group.outfitIndices)
+			addLayerDependents(catalog, index);
+
+		buildAliasTable(catalog, group.aliasTable, group.outfitIndices, false);
+		return group;
+	}
+
+	//Reads and resolves a scanned group from its file or pack, only reads the catalog so it doesn't need sCatalogWriteMutex
+	bool readGroupForms(const OutfitCatalog& catalog, const std::string& group_name, std::vector<LoadedGroup>& loaded_groups_out)
+	{
+		OutfitGroupMap::const_iterator group_it = catalog.groups.find(group_name);
+		if (group_it == catalog.groups.end())
+			return false;
+
+		loaded_groups_out.assign(1u, LoadedGroup());
+		FormRejections rejections;
+		if (group_it->second.packFile.empty()) {
+			if (!readGroupFile(catalog.groupDir + "/" + group_name + ".json", loaded_groups_out[0], true, rejections))
+				return false;
+		}
+		else if (!readPackedGroup(group_it->second.packFile, group_name, loaded_groups_out[0], rejections))
+			return false;
+
+		prepareLoadedGroups(loaded_groups_out, rejections, group_name);
+		return true;
+	}
+
+	//Resolves the forms of a group that was only scanned, caller must hold sCatalogWriteMutex
+	bool loadGroupForms(OutfitCatalog& catalog, const std::string& group_name)
+	{
+		OutfitGroupMap::iterator group_it = catalog.groups.find(group_name);
+		if (group_it == catalog.groups.end())
+			return false;
+		if (group_it->second.loaded)
+			return true;
+
+		std::vector<LoadedGroup> loaded_groups;
+		if (!readGroupForms(catalog, group_name, loaded_groups))
+			return false;
+
+		applyGroupFile(catalog, loaded_groups[0]);
+		OPL_DEBUG(LogCategory::kGroups, "Materialized outfit group {}", group_name);
+		return true;
+	}
+
+	//Layering
+
+	//A layer is "Outfit" in the outfit's own group or "Group/Outfit"
+	std::uint64_t splitLayerName(const Outfit& outfit, const std::string& layer, std::string& group_name_out, std::string& outfit_name_out)
+	{
+		std::size_t separator = layer.find('/');
+		group_name_out = separator == std::string::npos ? outfit.groupName.str() : layer.substr(0u, separator);
+		outfit_name_out = separator == std::string::npos ? layer : layer.substr(separator + 1u);
+		return getOutfitID(group_name_out, outfit_name_out);
+	}
+
+	int findLayerOutfit(const OutfitCatalog& catalog, const Outfit& outfit, const std::string& layer)
+	{
+		std::string group_name;
+		std::string outfit_name;
+		std::uint64_t layer_id = splitLayerName(outfit, layer, group_name, outfit_name);
+		return findOutfitIndex(catalog, layer_id, group_name, outfit_name);
+	}
+
+	//Caller must hold sCatalogWriteMutex
+	void addLayerDependents(OutfitCatalog& catalog, unsigned int index)
+	{
+		const Outfit& outfit = catalog.outfits[index];
+		std::string group_name;
+		std::string outfit_name;
+		for (const std::string& layer : outfit.layers) {
+			IndexVec& dependents = catalog.layerDependents[splitLayerName(outfit, layer, group_name, outfit_name)];
+			if (std::find(dependents.begin(), dependents.end(), index) == dependents.end())
+				dependents.push_back(index);
+		}
+	}
+
+	//Drops the entries of outfits that were removed or lost their layers
+	void indexLayerDependents(OutfitCatalog& catalog)
+	{
+		catalog.layerDependents.clear();
+		for (unsigned int i = 0u; i < catalog.outfits.size(); i++)
+			addLayerDependents(catalog, i);
+	}
+
+	//Adds the forms over the flattened list, a form replaces every form that shares one of its slots.
+	//masks holds the slot mask of each flattened form, so each form is resolved once.
+	void applyOutfitLayer(const FormVec& layer_forms, FormVec& forms, std::vector<std::uint32_t>& masks)
+	{
+		for (GameForm* form : layer_forms) {
+			std::uint32_t slot_mask = sFormResolver->getSlotMask(form);
+			if (slot_mask != 0u) {
+				std::size_t kept = 0u;
+				for (std::size_t i = 0u; i < forms.size(); i++) {
+					if ((masks[i] & slot_mask) != 0u)
+						continue;
+					forms[kept] = forms[i];
+					masks[kept] = masks[i];
+					kept++;
+				}
+				forms.resize(kept);
+				masks.resize(kept);
+			}
+			else if (std::find(forms.begin(), forms.end(), form) != forms.end())
+				continue;
+
+			forms.push_back(form);
+			masks.push_back(slot_mask);
+		}
+	}
+
+	enum LayerState : unsigned char
+	{
+		kLayerPending,
+		kLayerFlattening,
+		kLayerFlattened
+	};
+
+	//Layers are flattened first, so a layer can be layered itself
+	void flattenLayeredOutfit(OutfitCatalog& catalog, unsigned int index, std::vector<LayerState>& states)
+	{
+		states[index] = kLayerFlattening;
+
+		FormVec forms;
+		std::vector<std::uint32_t> masks;
+		const Outfit& outfit = catalog.outfits[index];
+		for (const std::string& layer : outfit.layers) {
+			int layer_index = findLayerOutfit(catalog, outfit, layer);
+			if (layer_index < 0) {
+				spdlog::warn("Outfit layer not found: {}:{}", outfit.name, layer);
+				continue;
+			}
+
+			if (states[layer_index] == kLayerFlattening) {
+				spdlog::error("Outfit layers form a cycle: {}:{}", outfit.name, layer);
+				continue;
+			}
+			if (states[layer_index] == kLayerPending && !catalog.outfits[layer_index].layers.empty())
+				flattenLayeredOutfit(catalog, static_cast<unsigned int>(layer_index), states);
+
+			applyOutfitLayer(catalog.outfits[layer_index].forms, forms, masks);
+		}
+
+		//Layering leaves no shared slots, and the flattened forms aren't saved so they can be kept in equip order
+		applyOutfitLayer(outfit.ownForms, forms, masks);
+		Outfit& flattened = catalog.outfits[index];
+		flattened.forms.swap(forms);
+		prepareOutfitForms(flattened, false);
+		if (!flattened.equipForms.empty()) {
+			flattened.forms.swap(flattened.equipForms);
+			FormVec().swap(flattened.equipForms);
+		}
+		states[index] = kLayerFlattened;
+	}
+
+	//Marks the layered outfits built on the outfit, directly or through other layers
+	void markLayerDependents(const OutfitCatalog& catalog, std::uint64_t outfit_id, std::vector<LayerState>& states, IndexVec& marked)
+	{
+		OutfitLayerMap::const_iterator it = catalog.layerDependents.find(outfit_id);
+		if (it == catalog.layerDependents.end())
+			return;
+
+		for (unsigned int index : it->second) {
+			if (states[index] == kLayerPending || catalog.outfits[index].layers.empty())
+				continue;
+			states[index] = kLayerPending;
+			marked.push_back(index);
+			markLayerDependents(catalog, catalog.outfits[index].id, states, marked);
+		}
+	}
+
+	//With lazy loading the marked outfits' layers may be in groups that are only scanned
+	bool loadLayerGroups(OutfitCatalog& catalog, const IndexVec& marked)
+	{
+		bool loaded_group = false;
+		for (unsigned int index : marked) {
+			for (unsigned int k = 0u; k < catalog.outfits[index].layers.size(); k++) {
+				int layer_index = findLayerOutfit(catalog, catalog.outfits[index], catalog.outfits[index].layers[k]);
+				if (layer_index < 0)
+					continue;
+
+				std::string group_name = catalog.outfits[layer_index].groupName;
+				OutfitGroupMap::const_iterator group_it = catalog.groups.find(group_name);
+				if (group_it != catalog.groups.end() && !group_it->second.loaded && loadGroupForms(catalog, group_name))
+					loaded_group = true;
+			}
+		}
+		return loaded_group;
+	}
+
+	//Flattens every layered outfit, or only those built on the outfits changed since the copy.
+	//Caller must hold sCatalogWriteMutex.
+	void flattenLayeredOutfits(OutfitCatalog& catalog, bool all)
+	{
+		if (catalog.layerDependents.empty() || (!all && sChangedOutfitIDs.empty())) {
+			sChangedOutfitIDs.clear();
+			return;
+		}
+
+		std::vector<LayerState> states(catalog.outfits.size(), kLayerFlattened);
+		IndexVec marked;
+		if (all) {
+			for (unsigned int i = 0u; i < catalog.outfits.size(); i++) {
+				if (!catalog.outfits[i].layers.empty()) {
+					states[i] = kLayerPending;
+					marked.push_back(i);
+				}
+			}
+		}
+
+		//Loading a layer's group changes its outfits, which can mark more outfits
+		std::size_t next_change = 0u;
+		do {
+			states.resize(catalog.outfits.size(), kLayerFlattened);
+			for (; next_change < sChangedOutfitIDs.size(); next_change++) {
+				int index = getOutfitIndexByID(catalog, sChangedOutfitIDs[next_change]);
+				if (index >= 0 && states[index] != kLayerPending && !catalog.outfits[index].layers.empty()) {
+					states[index] = kLayerPending;
+					marked.push_back(static_cast<unsigned int>(index));
+				}
+				markLayerDependents(catalog, sChangedOutfitIDs[next_change], states, marked);
+			}
+		} while (catalog.lazyGroupLoading && loadLayerGroups(catalog, marked));
+
+		for (unsigned int index : marked) {
+			if (states[index] == kLayerPending)
+				flattenLayeredOutfit(catalog, index, states);
+		}
+		sChangedOutfitIDs.clear();
+	}
+
+	//Rebuild the derived catalog-wide data and make the catalog visible to readers. Writers that
+	//don't add, remove or reweight outfits keep the copied catalog alias table.
+	void publishCatalog(MutableCatalogPtr catalog, bool weights_changed = true)
+	{
+		bool outfits_changed = !sChangedOutfitIDs.empty();
+		flattenLayeredOutfits(*catalog, false);
+
+		catalog->liveIndices.clear();
+		catalog->liveIndices.reserve(catalog->outfits.size());
+		for (unsigned int i = 0u; i < catalog->outfits.size(); i++) {
+			if (!catalog->outfits[i].groupName.empty())
+				catalog->liveIndices.push_back(i);
+		}
+
+		//Rebuilt whole, publishing already copies every outfit so an update in place wouldn't change the cost
+		if (weights_changed)
+			buildAliasTable(*catalog, catalog->aliasTable, catalog->liveIndices, true);
+		if (outfits_changed)
+			compileContextRules(*catalog); //Keeps the copied buckets unless a rule's outfits changed
+
+		catalog->version = ++sCatalogVersion;
+		sCatalog.store(catalog);
+		incrementPerfCounter(kCounterCatalogPublish);
+	}
+
+	//Adds a group that isn't in the catalog yet, caller must hold sCatalogWriteMutex
+	void addLoadedGroup(OutfitCatalog& catalog, LoadedGroup& loaded)
+	{
+		OutfitGroup& group = catalog.groups.insert(std::pair<std::string, OutfitGroup>(loaded.group.name, std::move(loaded.group))).first->second;
+		group.outfitIndices.reserve(loaded.outfits.size());
+		for (Outfit& outfit : loaded.outfits) {
+			group.outfitIndices.push_back(catalog.outfits.size());
+			catalog.outfits.push_back(std::move(outfit));
+			addOutfitID(catalog, group.outfitIndices.back());
+		}
+
+		buildAliasTable(catalog, group.aliasTable, group.outfitIndices, false);
+	}
+
+	void LoadCatalog(const std::string& group_dir, const Json::Value& config_json)
+	{
+		std::lock_guard<std::mutex> write_lock(sCatalogWriteMutex);
+
+		MutableCatalogPtr catalog = std::make_shared<OutfitCatalog>();
+		catalog->groupDir = group_dir;
+		catalog->lazyGroupLoading = config_json["lazyGroupLoading"].asBool();
+		catalog->historyWindow = config_json["historyWindow"].isUInt() ? config_json["historyWindow"].asUInt() : 3u;
+
+		Json::Value ignored_forms_json = config_json["ignoredForms"];
+		for (Json::Value::iterator it = ignored_forms_json.begin(); it != ignored_forms_json.end(); ++it) {
+			GameForm* form = NULL;
+			if (sFormResolver->deserializeForm(*it, form) && form)
+				catalog->ignoredFormIDs.insert(sFormResolver->getFormID(form));
+		}
+
+		spdlog::info("Loaded {} ignored form ids", catalog->ignoredFormIDs.size());
+
+		//Load Outfits
+		catalog->outfits.reserve(1024);
+
+		std::vector<LoadedGroup> loaded_groups;
+		std::unordered_set<std::string> group_names;
+		std::vector<std::string> pack_paths;
+		FormRejections rejections;
+		for (const auto& entry : std::filesystem::directory_iterator(group_dir)) {
+			std::string path = entry.path().string();
+			if (path.ends_with(OUTFIT_PACK_EXTENSION))
+				pack_paths.push_back(path);
+			if (!path.ends_with(".json"))
+				continue;
+
+			loaded_groups.push_back(LoadedGroup());
+			if (readGroupFile(path, loaded_groups.back(), !catalog->lazyGroupLoading, rejections))
+				group_names.insert(loaded_groups.back().group.name);
+			else
+				loaded_groups.pop_back();
+		}
+
+		//Group files override packed groups of the same name, so a packed group can be edited
+		std::sort(pack_paths.begin(), pack_paths.end());
+		for (const std::string& path : pack_paths)
+			readOutfitPack(path, loaded_groups, group_names, !catalog->lazyGroupLoading, rejections);
+
+		prepareLoadedGroups(loaded_groups, rejections, group_dir);
+		for (LoadedGroup& loaded_group : loaded_groups)
+			addLoadedGroup(*catalog, loaded_group);
+
+		catalog->outfits.shrink_to_fit(); //Drop the load reserve
+		OPL_INFO(LogCategory::kGroups, "Loaded {} outfits in {} groups", catalog->outfits.size(), catalog->groups.size());
+
+		sChangedOutfitIDs.clear();
+		indexLayerDependents(*catalog);
+		flattenLayeredOutfits(*catalog, true);
+		loadContextRules(*catalog, config_json["contextRules"]);
+		publishCatalog(catalog);
+	}
+
+	void ClearCatalog()
+	{
+		std::lock_guard<std::mutex> write_lock(sCatalogWriteMutex);
+		publishCatalog(std::make_shared<OutfitCatalog>());
+	}
+
+	void ReloadGroupFiles(const GroupFileChanges& changes)
+	{
+		PerfTimer timer(kPerfReloadGroupFiles);
+		std::lock_guard<std::mutex> write_lock(sCatalogWriteMutex);
+		MutableCatalogPtr catalog = copyCatalog();
+
+		for (const std::string& file_name : changes.removed) {
+			std::string group_name = std::filesystem::path(file_name).replace_extension("").string();
+			OutfitGroupMap::iterator group_it = catalog->groups.find(group_name);
+			if (group_it == catalog->groups.end())
+				continue;
+
+			OPL_INFO(LogCategory::kGroups, "Outfit group file removed {}", file_name);
+			for (unsigned int index : group_it->second.outfitIndices)
+				tombstoneOutfit(*catalog, index);
+			catalog->groups.erase(group_it);
+		}
+
+		std::vector<LoadedGroup> loaded_groups;
+		FormRejections rejections;
+		for (const std::string& file_name : changes.changed) {
+			//Groups nobody has touched yet stay scanned only
+			OutfitGroupMap::const_iterator existing_it = catalog->groups.find(std::filesystem::path(file_name).replace_extension("").string());
+			bool resolve_forms = !catalog->lazyGroupLoading || (existing_it != catalog->groups.end() && existing_it->second.loaded);
+
+			loaded_groups.push_back(LoadedGroup());
+			if (!readGroupFile(catalog->groupDir + "/" + file_name, loaded_groups.back(), resolve_forms, rejections))
+				loaded_groups.pop_back(); //Keep the old version until the file parses
+		}
+
+		prepareLoadedGroups(loaded_groups, rejections, "changed group files");
+		for (LoadedGroup& loaded_group : loaded_groups) {
+			OutfitGroup& group = applyGroupFile(*catalog, loaded_group);
+			OPL_INFO(LogCategory::kGroups, "Reloaded outfit group {} with {} outfits", group.name, group.outfitIndices.size());
+		}
+
+		publishCatalog(catalog);
+	}
+
+	CatalogPtr materializeOutfitGroup(const std::string& group_name)
+	{
+		CatalogPtr catalog = getCatalog();
+		OutfitGroupMap::const_iterator group_it = catalog->groups.find(group_name);
+		if (group_it == catalog->groups.end() || group_it->second.loaded)
+			return catalog;
+
+		//Reading and resolving is the slow part, writers only wait for the apply
+		std::vector<LoadedGroup> loaded_groups;
+		if (!readGroupForms(*catalog, group_name, loaded_groups))
+			return getCatalog();
+
+		std::lock_guard<std::mutex> write_lock(sCatalogWriteMutex);
+		CatalogPtr current_catalog = getCatalog();
+		group_it = current_catalog->groups.find(group_name);
+		if (group_it == current_catalog->groups.end() || group_it->second.loaded)
+			return current_catalog; //Loaded by another call, or removed, while this one was reading
+
+		MutableCatalogPtr loaded_catalog = copyCatalog();
+		if (current_catalog->version == catalog->version) {
+			applyGroupFile(*loaded_catalog, loaded_groups[0]);
+			OPL_DEBUG(LogCategory::kGroups, "Materialized outfit group {}", group_name);
+		}
+		else if (!loadGroupForms(*loaded_catalog, group_name))
+			return current_catalog; //A writer published in between and may have rescanned the file, read it again
+
+		publishCatalog(loaded_catalog);
+		return loaded_catalog;
+	}
+
+	CatalogPtr materializeOutfit(unsigned int index)
+	{
+		CatalogPtr catalog = getCatalog();
+		if (!catalog->lazyGroupLoading || index >= catalog->outfits.size() || catalog->outfits[index].groupName.empty())
+			return catalog;
+		return materializeOutfitGroup(catalog->outfits[index].groupName);
+	}
+
+	//Playlists
+
+	void shuffleIndices(const IndexVec& indices, unsigned int seed, IndexVec& shuffled_out)
+	{
+		std::mt19937 engine;
+		engine.seed(seed);
+		shuffled_out.clear();
+		shuffled_out.reserve(indices.size());
+
+		IndexVec remaining_indices = indices;
+		while (!remaining_indices.empty()) {
+			unsigned int i = engine() % remaining_indices.size();
+			shuffled_out.push_back(remaining_indices[i]);
+
+			if (remaining_indices.size() > 1u)
+				remaining_indices[i] = remaining_indices[remaining_indices.size() - 1];
+			remaining_indices.pop_back();
+		}
+	}
+
+	ShuffleCachePtr shuffleOutfits(const OutfitCatalog& catalog, unsigned int seed) {
+		ShuffleCachePtr cache = sShuffleCache.load();
+		if (cache && cache->version == catalog.version && cache->seed == seed) {
+			incrementPerfCounter(kCounterShuffleCacheHit);
+			return cache;
+		}
+
+		incrementPerfCounter(kCounterShuffleCacheMiss);
+
+		OPL_DEBUG(LogCategory::kOutfits, "Shuffling outfits with seed {}", seed);
+
+		//Racing readers may both shuffle, they produce the same result so either store wins
+		std::shared_ptr<ShuffleCache> shuffled = std::make_shared<ShuffleCache>();
+		shuffled->version = catalog.version;
+		shuffled->seed = seed;
+		shuffleIndices(catalog.liveIndices, seed, shuffled->indices);
+
+		sShuffleCache.store(shuffled);
+		return shuffled;
+	}
+
+	PlaylistPtr findCachedPlaylist(const OutfitCatalog& catalog, const std::string& key)
+	{
+		std::lock_guard<std::mutex> lock(sPlaylistMutex);
+		GroupPlaylistMap::iterator it = sGroupPlaylists.find(key);
+		if (it == sGroupPlaylists.end() || it->second.playlist->version != catalog.version)
+			return PlaylistPtr();
+
+		sRecentPlaylists.splice(sRecentPlaylists.begin(), sRecentPlaylists, it->second.recentIt);
+		incrementPerfCounter(kCounterPlaylistCacheHit);
+		return it->second.playlist;
+	}
+
+	PlaylistPtr addCachedPlaylist(const OutfitCatalog& catalog, const std::string& key, const IndexVec& indices, int seed)
+	{
+		incrementPerfCounter(kCounterPlaylistCacheMiss);
+
+		std::shared_ptr<GroupPlaylist> playlist = std::make_shared<GroupPlaylist>();
+		playlist->version = catalog.version;
+		if (seed < 0)
+			playlist->outfitIndices = indices;
+		else
+			shuffleIndices(indices, static_cast<unsigned int>(seed), playlist->outfitIndices);
+
+		playlist->positions.reserve(playlist->outfitIndices.size());
+		for (unsigned int i = 0u; i < playlist->outfitIndices.size(); i++)
+			playlist->positions[playlist->outfitIndices[i]] = i;
+
+		std::lock_guard<std::mutex> lock(sPlaylistMutex);
+		GroupPlaylistMap::iterator it = sGroupPlaylists.find(key);
+		if (it == sGroupPlaylists.end()) {
+			if (sGroupPlaylists.size() >= MAX_GROUP_PLAYLISTS) {
+				sGroupPlaylists.erase(sRecentPlaylists.back());
+				sRecentPlaylists.pop_back();
+			}
+			sRecentPlaylists.push_front(key);
+			it = sGroupPlaylists.insert(GroupPlaylistMap::value_type(key, CachedPlaylist())).first;
+			it->second.recentIt = sRecentPlaylists.begin();
+		}
+		else
+			sRecentPlaylists.splice(sRecentPlaylists.begin(), sRecentPlaylists, it->second.recentIt);
+
+		//A reader still on an older catalog doesn't replace a newer playlist
+		if (!it->second.playlist || it->second.playlist->version <= playlist->version)
+			it->second.playlist = playlist;
+		return playlist;
+	}
+
+	PlaylistPtr getCachedPlaylist(const OutfitCatalog& catalog, const std::string& key, const IndexVec& indices, int seed)
+	{
+		PlaylistPtr playlist = findCachedPlaylist(catalog, key);
+		if (playlist)
+			return playlist;
+		return addCachedPlaylist(catalog, key, indices, seed);
+	}
+
+	PlaylistPtr getGroupPlaylist(const OutfitCatalog& catalog, const std::vector<std::string>& group_names, int seed)
+	{
+		std::vector<const std::string*>& sorted_names = tPlaylistGroupNames;
+		sorted_names.clear();
+		for (const std::string& group_name : group_names)
+			sorted_names.push_back(&group_name);
+		std::sort(sorted_names.begin(), sorted_names.end(), [](const std::string* name1, const std::string* name2) { return *name1 < *name2; });
+		sorted_names.erase(std::unique(sorted_names.begin(), sorted_names.end(), [](const std::string* name1, const std::string* name2) { return *name1 == *name2; }), sorted_names.end());
+
+		//'|' can't appear in a group file name
+		std::string& key = tPlaylistKey;
+		key.clear();
+		fmt::format_to(std::back_inserter(key), "{}", seed < 0 ? -1 : seed);
+		for (const std::string* group_name : sorted_names) {
+			key.push_back('|');
+			key.append(*group_name);
+		}
+
+		//Only a miss looks at the groups' outfits
+		PlaylistPtr playlist = findCachedPlaylist(catalog, key);
+		if (playlist)
+			return playlist;
+
+		IndexVec indices;
+		for (const std::string* group_name : sorted_names) {
+			OutfitGroupMap::const_iterator group_it = catalog.groups.find(*group_name);
+			if (group_it != catalog.groups.end())
+				indices.insert(indices.end(), group_it->second.outfitIndices.begin(), group_it->second.outfitIndices.end());
+		}
+
+		return addCachedPlaylist(catalog, key, indices, seed);
+	}
+
+	int getShuffledOutfitIndex(const OutfitCatalog& catalog, int shuffle_index, int seed)
+	{
+		//Catalog order skips outfits removed by a reload
+		if (seed < 0) {
+			if (!catalog.liveIndices.empty())
+				return static_cast<int>(catalog.liveIndices[shuffle_index % catalog.liveIndices.size()]);
+		}
+		else {
+			ShuffleCachePtr shuffled = shuffleOutfits(catalog, seed);
+			if (!shuffled->indices.empty())
+				return static_cast<int>(shuffled->indices[shuffle_index % shuffled->indices.size()]);
+		}
+
+		return 0;
+	}
+
+	int getOutfitShuffleIndex(const OutfitCatalog& catalog, int index, int seed)
+	{
+		if (seed < 0) {
+			IndexVec::const_iterator it = std::lower_bound(catalog.liveIndices.begin(), catalog.liveIndices.end(), static_cast<unsigned int>(index));
+			if (index < 0 || it == catalog.liveIndices.end() || *it != static_cast<unsigned int>(index))
+				return 0;
+			return static_cast<int>(it - catalog.liveIndices.begin());
+		}
+
+		if (index < 0 || static_cast<unsigned int>(index) >= catalog.outfits.size())
+			return 0;
+
+		ShuffleCachePtr shuffled = shuffleOutfits(catalog, seed);
+		for (unsigned int i = 0u; i < shuffled->indices.size(); i++) {
+			if (shuffled->indices[i] == static_cast<unsigned int>(index))
+				return i;
+		}
+
+		return 0;
+	}
+
+	int getGroupShuffledOutfitIndex(const OutfitCatalog& catalog, const std::vector<std::string>& group_names, int shuffle_index, int seed)
+	{
+		PlaylistPtr playlist = getGroupPlaylist(catalog, group_names, seed);
+		if (playlist->outfitIndices.empty() || shuffle_index < 0)
+			return -1;
+		return static_cast<int>(playlist->outfitIndices[static_cast<unsigned int>(shuffle_index) % playlist->outfitIndices.size()]);
+	}
+
+	int getGroupOutfitShuffleIndex(const OutfitCatalog& catalog, const std::vector<std::string>& group_names, int index, int seed)
+	{
+		if (index < 0)
+			return -1;
+
+		PlaylistPtr playlist = getGroupPlaylist(catalog, group_names, seed);
+		std::unordered_map<unsigned int, unsigned int>::const_iterator it = playlist->positions.find(static_cast<unsigned int>(index));
+		if (it != playlist->positions.end())
+			return static_cast<int>(it->second);
+		return -1;
+	}
+
+	//Weighted selection
+
+	void buildAliasTable(const OutfitCatalog& catalog, AliasTable& table, const IndexVec& outfit_indices, bool use_group_weights)
+	{
+		table.outfitIndices = outfit_indices;
+		table.probabilities.assign(outfit_indices.size(), 1.0f);
+		table.aliases.resize(outfit_indices.size());
+
+		std::size_t count = outfit_indices.size();
+		if (count == 0u)
+			return;
+
+		std::vector<double> scaled(count);
+		double total = 0.0;
+		for (std::size_t i = 0u; i < count; i++) {
+			const Outfit& outfit = catalog.outfits[outfit_indices[i]];
+			scaled[i] = outfit.weight;
+			if (use_group_weights) {
+				OutfitGroupMap::const_iterator group_it = catalog.groups.find(outfit.groupName);
+				if (group_it != catalog.groups.end())
+					scaled[i] *= group_it->second.weight;
+			}
+			total += scaled[i];
+			table.aliases[i] = static_cast<unsigned int>(i);
+		}
+
+		//All weights zero falls back to a uniform table
+		if (total <= 0.0)
+			return;
+
+		IndexVec small;
+		IndexVec large;
+		for (std::size_t i = 0u; i < count; i++) {
+			scaled[i] = scaled[i] * count / total;
+			if (scaled[i] < 1.0)
+				small.push_back(static_cast<unsigned int>(i));
+			else
+				large.push_back(static_cast<unsigned int>(i));
+		}
+
+		while (!small.empty() && !large.empty()) {
+			unsigned int s = small.back();
+			unsigned int l = large.back();
+			small.pop_back();
+			large.pop_back();
+
+			table.probabilities[s] = static_cast<float>(scaled[s]);
+			table.aliases[s] = l;
+
+			scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+			if (scaled[l] < 1.0)
+				small.push_back(l);
+			else
+				large.push_back(l);
+		}
+
+		//Leftovers are only off by rounding error
+		for (unsigned int i : small)
+			table.probabilities[i] = 1.0f;
+		for (unsigned int i : large)
+			table.probabilities[i] = 1.0f;
+	}
+
+	std::uint64_t mixSeed(unsigned int seed, unsigned int draw_index)
+	{
+		//splitmix64 finalizer, so each (seed, draw) pair is reproducible without replaying earlier draws
+		std::uint64_t x = (static_cast<std::uint64_t>(seed) << 32) | draw_index;
+		x += 0x9E3779B97F4A7C15ull;
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+		return x ^ (x >> 31);
+	}
+
+	int sampleAliasTable(const AliasTable& table, std::uint64_t random)
+	{
+		if (table.outfitIndices.empty())
+			return -1;
+
+		unsigned int column = static_cast<unsigned int>((random >> 32) % table.outfitIndices.size());
+		float coin = static_cast<float>(random & 0xFFFFFFull) / static_cast<float>(0x1000000);
+		if (coin < table.probabilities[column])
+			return static_cast<int>(table.outfitIndices[column]);
+		return static_cast<int>(table.outfitIndices[table.aliases[column]]);
+	}
+
+	int getWeightedOutfitIndex(const OutfitCatalog& catalog, const std::string& group_name, int draw_index, int seed)
+	{
+		const AliasTable* table = &catalog.aliasTable;
+		if (!group_name.empty()) {
+			OutfitGroupMap::const_iterator group_it = catalog.groups.find(group_name);
+			if (group_it == catalog.groups.end())
+				return -1;
+			table = &group_it->second.aliasTable;
+		}
+
+		return sampleAliasTable(*table, mixSeed(static_cast<unsigned int>(seed), static_cast<unsigned int>(draw_index)));
+	}
+
+	//Group files
+
+	//"Name.001", used to make names unique
+	std::string getDiscriminatedName(const std::string& name, unsigned int discriminator)
+	{
+		return fmt::format("{}.{:03}", name, discriminator);
+	}
+
+	void serializeOutfitGroup(const OutfitCatalog& catalog, const OutfitGroup& group, Json::Value& json_value) {
+		json_value["outfits"] = Json::Value(Json::objectValue);
+		Json::Value& outfit_dict = json_value["outfits"];
+
+		if (group.weight != 1.0f)
+			json_value["weight"] = group.weight;
+
+		for (unsigned int i = 0u; i < group.outfitIndices.size(); i++)
+		{
+			const Outfit& outfit = catalog.outfits[group.outfitIndices[i]];
+			std::string name = outfit.name;
+
+			//Names are already unique in the catalog, this only guards the file
+			unsigned int discriminator = 0u;
+			while (outfit_dict.isMember(name))
+				name = getDiscriminatedName(outfit.name, ++discriminator);
+
+			outfit_dict[name] = Json::Value(Json::arrayValue);
+			if (outfit.weight != 1.0f)
+				json_value["weights"][name] = outfit.weight;
+
+			//Layered outfits keep their layers, only their own forms are written
+			const FormVec& forms = outfit.layers.empty() ? outfit.forms : outfit.ownForms;
+			for (const std::string& layer : outfit.layers)
+				json_value["layers"][name].append(layer);
+
+			Json::Value& forms_list = outfit_dict[name];
+			for (unsigned k = 0u; k < forms.size(); k++) {
+				Json::Value form_id_json;
+				sFormResolver->serializeForm(forms[k], form_id_json);
+				forms_list.append(form_id_json);
+			}
+		}
+	}
+
+	void saveGroupFile(const OutfitCatalog& catalog, const OutfitGroup& group) {
+		PerfTimer timer(kPerfSaveGroupFile);
+
+		//Writing a scanned only group would drop every form in the file
+		if (!group.loaded) {
+			spdlog::error("Outfit group {} isn't loaded, not saving it", group.name);
+			return;
+		}
+
+		Json::Value group_json;
+		serializeOutfitGroup(catalog, group, group_json);
+
+		std::string group_file_path = catalog.groupDir + "/";
+		group_file_path.append(group.name);
+		group_file_path.append(".json");
+
+		{
+			std::ofstream group_file(group_file_path);
+
+			Json::StyledStreamWriter writer;
+			writer.write(group_file, group_json);
+		}
+
+		refreshGroupFileState(group_file_path); //Don't hot reload our own write
+	}
+
+	//Lookup
+
+	int getOutfitIndex(const OutfitCatalog& catalog, const std::string& group_name, const std::string& outfit_name) {
+		OutfitGroupMap::const_iterator it = catalog.groups.find(group_name);
+		if (it != catalog.groups.end()) {
+			//Case-sensitive
+			for (unsigned int i = 0u; i < it->second.outfitIndices.size(); i++) {
+				if (catalog.outfits[it->second.outfitIndices[i]].name == outfit_name)
+					return static_cast<int>(it->second.outfitIndices[i]);
+			}
+
+			//Non case-sensitive search because Skyrim messes with string casing
+			for (unsigned int i = 0u; i < it->second.outfitIndices.size(); i++) {
+				if (equalsIgnoreCase(outfit_name, catalog.outfits[it->second.outfitIndices[i]].name))
+					return static_cast<int>(it->second.outfitIndices[i]);
+			}
+		}
+		return -1;
+	}
+
+	std::uint64_t getOutfitID(const std::string& group_name, const std::string& outfit_name)
+	{
+		std::string lowercase_group = toLowercase(group_name);
+		std::string lowercase_name = toLowercase(outfit_name);
+		std::uint64_t hash = hashBytes(lowercase_group.data(), lowercase_group.size() + 1u); //Include the terminator as a separator
+		hash = hashBytes(lowercase_name.data(), lowercase_name.size(), hash);
+		return hash == 0u ? 1u : hash;
+	}
+
+	int getOutfitIndexByID(const OutfitCatalog& catalog, std::uint64_t outfit_id)
+	{
+		OutfitIDMap::const_iterator it = catalog.idIndices.find(outfit_id);
+		return it != catalog.idIndices.end() ? static_cast<int>(it->second) : -1;
+	}
+
+	int findOutfitIndex(const OutfitCatalog& catalog, std::uint64_t outfit_id, const std::string& group_name, const std::string& outfit_name)
+	{
+		int index = getOutfitIndexByID(catalog, outfit_id);
+		if (index < 0)
+			return -1; //The id is case-insensitive, no spelling of the name is in the group
+		const Outfit& outfit = catalog.outfits[index];
+		if (outfit.name == outfit_name && outfit.groupName == group_name)
+			return index;
+		return getOutfitIndex(catalog, group_name, outfit_name); //Names that only differ in case share the id
+	}
+
+	//The id table doubles as the group's case-folded name index
+	bool isOutfitNameTaken(const OutfitCatalog& catalog, const OutfitGroup& group, const std::string& name, const std::string& ignore_name)
+	{
+		int index = getOutfitIndexByID(catalog, getOutfitID(group.name, name));
+		return index >= 0 && catalog.outfits[index].name != ignore_name;
+	}
+
+	std::string makeNameUniqueForGroup(const OutfitCatalog& catalog, OutfitGroup& group, const std::string& name, const std::string& ignore_name = std::string())
+	{
+		if (!isOutfitNameTaken(catalog, group, name, ignore_name))
+			return name;
+
+		//Use a discriminator to make sure the outfit name is unique, continuing from the last one given out
+		unsigned int& discriminator = group.nameDiscriminators[toLowercase(name)];
+		std::string unique_name;
+		do {
+			discriminator++;
+			unique_name = getDiscriminatedName(name, discriminator);
+		} while (isOutfitNameTaken(catalog, group, unique_name, ignore_name));
+
+		return unique_name;
+	}
+
+	bool outfitFormsAreTheSame(const Outfit& outfit1, const Outfit& outfit2) {
+		if (outfit1.forms.size() != outfit2.forms.size())
+			return false;
+
+		for (unsigned int i = 0u; i < outfit1.forms.size(); i++) {
+			bool found = false;
+			for (unsigned int k = 0u; k < outfit2.forms.size(); k++) {
+				if (outfit2.forms[k] == outfit1.forms[i]) {
+					found = true;
+					break;
+				}
+			}
+			if (!found)
+				return false;
+		}
+
+		return true;
+	}
+
+	void prepareOutfitForms(Outfit& outfit, bool warn_conflicts)
+	{
+		typedef std::pair<std::uint32_t, GameForm*> SlottedForm;
+		std::vector<SlottedForm> slotted_forms;
+		slotted_forms.reserve(outfit.forms.size());
+
+		outfit.slotMask = 0u;
+		std::uint32_t conflicts = 0u;
+		for (GameForm* form : outfit.forms) {
+			std::uint32_t slot_mask = sFormResolver->getSlotMask(form);
+			conflicts |= outfit.slotMask & slot_mask;
+			outfit.slotMask |= slot_mask;
+			slotted_forms.push_back(SlottedForm(slot_mask, form));
+		}
+
+		if (warn_conflicts && conflicts != 0u)
+			spdlog::warn("Outfit {}:{} has pieces sharing slots {:08X}", outfit.groupName, outfit.name, conflicts);
+
+		std::stable_sort(slotted_forms.begin(), slotted_forms.end(), [](const SlottedForm& form1, const SlottedForm& form2) {
+			int count1 = form1.first == 0u ? -1 : std::popcount(form1.first);
+			int count2 = form2.first == 0u ? -1 : std::popcount(form2.first);
+			return count1 > count2;
+		});
+
+		//Most outfits are written in equip order already, they don't need a second list
+		outfit.equipForms.clear();
+		for (std::size_t i = 0u; i < slotted_forms.size(); i++) {
+			if (slotted_forms[i].second != outfit.forms[i]) {
+				outfit.equipForms.reserve(slotted_forms.size());
+				for (const SlottedForm& slotted_form : slotted_forms)
+					outfit.equipForms.push_back(slotted_form.second);
+				break;
+			}
+		}
+	}
+
+	//Editing
+
+	bool registerOutfit(Outfit outfit, const std::string& group_name, unsigned int& index_out)
+	{
+		std::lock_guard<std::mutex> write_lock(sCatalogWriteMutex);
+		MutableCatalogPtr catalog = copyCatalog();
+
+		//Get/add the custom outfit group
+		OutfitGroupMap::iterator group_it = catalog->groups.find(group_name);
+		if (group_it == catalog->groups.end()) {
+			group_it = catalog->groups.insert(std::pair<std::string, OutfitGroup>(group_name, OutfitGroup())).first;
+			group_it->second.name = SharedName(group_name);
+		}
+		else if (!loadGroupForms(*catalog, group_name))
+			return false;
+
+		//Check if the outfit already exists in the group
+		for (unsigned int i = 0u; i < group_it->second.outfitIndices.size(); i++) {
+			const Outfit& existing = catalog->outfits[group_it->second.outfitIndices[i]];
+			if (outfitFormsAreTheSame(outfit, existing))
+				return false;
+		}
+
+		//Add a new outfit and assign it to the group
+		index_out = catalog->outfits.size();
+		outfit.name = makeNameUniqueForGroup(*catalog, group_it->second, outfit.name);
+		outfit.groupName = group_it->second.name;
+		outfit.id = getOutfitID(outfit.groupName, outfit.name);
+		prepareOutfitForms(outfit, true);
+		catalog->outfits.push_back(outfit);
+		group_it->second.outfitIndices.push_back(index_out);
+		addOutfitID(*catalog, index_out);
+		sChangedOutfitIDs.push_back(outfit.id); //Can be a layer that wasn't found before
+
+		//Only the touched group's table needs rebuilding, the catalog table is rebuilt on publish
+		buildAliasTable(*catalog, group_it->second.aliasTable, group_it->second.outfitIndices, false);
+
+		saveGroupFile(*catalog, group_it->second); //Save the group file
+		publishCatalog(catalog);
+		return true;
+	}
+
+	int replaceOutfitForms(const std::string& group_name, const std::string& outfit_name, const FormVec& forms)
+	{
+		std::lock_guard<std::mutex> write_lock(sCatalogWriteMutex);
+		MutableCatalogPtr catalog = copyCatalog();
+
+		OutfitGroupMap::iterator group_it = catalog->groups.find(group_name);
+		bool was_loaded = group_it != catalog->groups.end() && group_it->second.loaded; //Loading rereads the file, which may have changed
+		if (group_it == catalog->groups.end() || !loadGroupForms(*catalog, group_name))
+			return -1; //Group not found
+
+		int outfit_index = getOutfitIndex(*catalog, group_name, outfit_name);
+		if (outfit_index < 0 || static_cast<unsigned int>(outfit_index) >= catalog->outfits.size())
+			return -1; //Outfit not found
+
+		catalog->outfits[outfit_index].forms = forms;  //Replace the formlist for the outfit
+		catalog->outfits[outfit_index].layers.clear(); //The new forms are already flat
+		catalog->outfits[outfit_index].ownForms.clear();
+		prepareOutfitForms(catalog->outfits[outfit_index], true);
+		sChangedOutfitIDs.push_back(catalog->outfits[outfit_index].id);
+		saveGroupFile(*catalog, group_it->second); //Save the group file
+		publishCatalog(catalog, !was_loaded);
+		return outfit_index;
+	}
+
+	int renameOutfit(const std::string& group_name, const std::string& outfit_name, const std::string& new_name)
+	{
+		std::lock_guard<std::mutex> write_lock(sCatalogWriteMutex);
+		MutableCatalogPtr catalog = copyCatalog();
+
+		OutfitGroupMap::iterator group_it = catalog->groups.find(group_name);
+		bool was_loaded = group_it != catalog->groups.end() && group_it->second.loaded; //Loading rereads the file, which may have changed
+		if (group_it == catalog->groups.end() || !loadGroupForms(*catalog, group_name))
+			return -1; //Group not found
+
+		int outfit_index = getOutfitIndex(*catalog, group_name, outfit_name);
+		if (outfit_index < 0 || static_cast<unsigned int>(outfit_index) >= catalog->outfits.size())
+			return -1; //Outfit not found
+
+		Outfit& outfit = catalog->outfits[outfit_index];
+		removeOutfitID(*catalog, static_cast<unsigned int>(outfit_index));
+		sChangedOutfitIDs.push_back(outfit.id); //Layers naming either name resolve differently now
+		outfit.name = makeNameUniqueForGroup(*catalog, group_it->second, new_name, outfit_name);  //Update the outfit name
+		outfit.id = getOutfitID(outfit.groupName, outfit.name);
+		addOutfitID(*catalog, outfit_index);
+		sChangedOutfitIDs.push_back(outfit.id);
+		saveGroupFile(*catalog, group_it->second); //Save the group file
+		publishCatalog(catalog, !was_loaded);
+		return outfit_index;
+	}
+
+	//Memory
+
+	std::size_t CompactCatalog()
+	{
+		MemoryUsage before;
+		getMemoryUsage(before);
+
+		{
+			std::lock_guard<std::mutex> write_lock(sCatalogWriteMutex);
+
+			//Copying allocates every vector and string at its size, only tombstones need more
+			MutableCatalogPtr catalog = copyCatalog();
+			unsigned int tombstones = 0u;
+			for (Outfit& outfit : catalog->outfits) {
+				if (!outfit.groupName.empty())
+					continue;
+				std::string().swap(outfit.name);
+				FormVec().swap(outfit.forms);
+				FormVec().swap(outfit.ownForms);
+				FormVec().swap(outfit.equipForms);
+				std::vector<SharedName>().swap(outfit.layers);
+				tombstones++;
+			}
+			indexLayerDependents(*catalog);
+
+			publishCatalog(catalog, false);
+			OPL_INFO(LogCategory::kPerf, "Compacted catalog, {} tombstoned outfits released", tombstones);
+		}
+
+		//Playlists are rebuilt on demand for the new version
+		{
+			std::lock_guard<std::mutex> lock(sPlaylistMutex);
+			GroupPlaylistMap().swap(sGroupPlaylists);
+			PlaylistKeyList().swap(sRecentPlaylists);
+		}
+		sShuffleCache.store(ShuffleCachePtr());
+
+		MemoryUsage after;
+		getMemoryUsage(after);
+		return before.getTotal() > after.getTotal() ? before.getTotal() - after.getTotal() : 0u;
+	}
+
+	std::size_t getAliasTableBytes(const AliasTable& table)
+	{
+		return getVectorHeapBytes(table.outfitIndices) + getVectorHeapBytes(table.probabilities) + getVectorHeapBytes(table.aliases);
+	}
+
+	void addCatalogMemoryUsage(const OutfitCatalog& catalog, MemoryUsage& usage)
+	{
+		SharedNameSet seen_names;
+		usage.outfits += sizeof(OutfitCatalog) + getVectorHeapBytes(catalog.outfits);
+		for (const Outfit& outfit : catalog.outfits) {
+			usage.forms += getVectorHeapBytes(outfit.forms) + getVectorHeapBytes(outfit.ownForms) + getVectorHeapBytes(outfit.equipForms) + getVectorHeapBytes(outfit.layers);
+			for (const SharedName& layer : outfit.layers)
+				usage.strings += getSharedNameHeapBytes(layer, seen_names);
+			usage.strings += getStringHeapBytes(outfit.name) + getSharedNameHeapBytes(outfit.groupName, seen_names);
+		}
+
+		for (OutfitGroupMap::const_iterator it = catalog.groups.begin(); it != catalog.groups.end(); ++it) {
+			usage.groups += MAP_NODE_OVERHEAD + sizeof(OutfitGroupMap::value_type);
+			usage.groups += getVectorHeapBytes(it->second.outfitIndices) + getAliasTableBytes(it->second.aliasTable);
+			usage.groups += it->second.nameDiscriminators.size() * (MAP_NODE_OVERHEAD + sizeof(std::pair<std::string, unsigned int>));
+			usage.strings += getStringHeapBytes(it->first) + getSharedNameHeapBytes(it->second.name, seen_names) + getStringHeapBytes(it->second.packFile);
+		}
+		usage.groups += getVectorHeapBytes(catalog.liveIndices) + getAliasTableBytes(catalog.aliasTable);
+		usage.groups += catalog.idIndices.bucket_count() * sizeof(void*) + catalog.idIndices.size() * (sizeof(void*) + sizeof(OutfitIDMap::value_type));
+		usage.groups += catalog.layerDependents.bucket_count() * sizeof(void*) + catalog.layerDependents.size() * (sizeof(void*) + sizeof(OutfitLayerMap::value_type));
+		for (OutfitLayerMap::const_iterator it = catalog.layerDependents.begin(); it != catalog.layerDependents.end(); ++it)
+			usage.groups += getVectorHeapBytes(it->second);
+
+		addContextMemoryUsage(catalog, usage);
+
+		usage.other += catalog.ignoredFormIDs.size() * (MAP_NODE_OVERHEAD + sizeof(FormID));
+	}
+
+	void addCacheMemoryUsage(MemoryUsage& usage)
+	{
+		ShuffleCachePtr shuffled = sShuffleCache.load();
+		if (shuffled)
+			usage.caches += sizeof(ShuffleCache) + getVectorHeapBytes(shuffled->indices);
+
+		std::lock_guard<std::mutex> lock(sPlaylistMutex);
+		usage.caches += sGroupPlaylists.bucket_count() * sizeof(void*);
+		for (GroupPlaylistMap::const_iterator it = sGroupPlaylists.begin(); it != sGroupPlaylists.end(); ++it) {
+			const GroupPlaylist& playlist = *it->second.playlist;
+			usage.caches += MAP_NODE_OVERHEAD + sizeof(GroupPlaylistMap::value_type) + getStringHeapBytes(it->first);
+			usage.caches += MAP_NODE_OVERHEAD + sizeof(std::string) + getStringHeapBytes(*it->second.recentIt); //Recent list node
+			usage.caches += sizeof(GroupPlaylist) + getVectorHeapBytes(playlist.outfitIndices);
+			usage.caches += playlist.positions.bucket_count() * sizeof(void*) + playlist.positions.size() * (2u * sizeof(void*) + sizeof(std::pair<unsigned int, unsigned int>));
+		}
+	}
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "GameData.h"
+#include "GroupWatcher.h"
+#include "SharedName.h"
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace OutfitPlaylist
+{
+	struct MemoryUsage;
+	struct ContextRuleSet;
+	struct ContextBuckets;
+
+	typedef std::vector<GameForm*> FormVec;
+	typedef std::vector<unsigned int> IndexVec;
+
+	struct Outfit
+	{
+		std::uint64_t id; //Stable across runs, derived from the group and name
+		std::string name;
+		SharedName groupName; //The group's own name, shared by all of its outfits
+		FormVec forms; //Flattened forms for layered outfits, otherwise in the order they're saved
+		FormVec equipForms; //The forms in equip order, empty when forms already are
+		std::vector<SharedName> layers; //Outfits this one is built on, "Outfit" in the same group or "Group/Outfit"
+		FormVec ownForms; //The layered outfit's own forms, applied over its layers
+		std::uint32_t slotMask; //Biped slots of all forms combined
+		float weight;
+		bool doNotRemove;
+		Outfit();
+	};
+
+	//Walker/Vose alias table for O(1) weighted draws
+	struct AliasTable
+	{
+		IndexVec outfitIndices;
+		std::vector<float> probabilities;
+		IndexVec aliases;
+	};
+
+	struct OutfitGroup
+	{
+		SharedName name;
+		IndexVec outfitIndices;
+		float weight;
+		AliasTable aliasTable;
+		bool loaded; //Lazy loading scans names only, forms stay empty until the group is materialized
+		std::string packFile; //Outfit pack the group was read from, empty for group files
+		std::unordered_map<std::string, unsigned int> nameDiscriminators; //Last discriminator given out per lowercase base name
+		OutfitGroup();
+	};
+
+	//A group read from a group file or outfit pack, before it is added to the catalog
+	struct LoadedGroup
+	{
+		OutfitGroup group;
+		std::vector<Outfit> outfits;
+	};
+
+	typedef std::map<std::string, OutfitGroup> OutfitGroupMap;
+	typedef std::unordered_map<std::uint64_t, unsigned int> OutfitIDMap;
+	typedef std::unordered_map<std::uint64_t, IndexVec> OutfitLayerMap;
+	typedef std::shared_ptr<const ContextRuleSet> ContextRuleSetPtr;
+	typedef std::shared_ptr<const ContextBuckets> ContextBucketsPtr;
+	typedef std::shared_ptr<const IndexVec> ContextBucketPtr;
+
+	//Everything Papyrus reads about the catalog. A published catalog is never modified;
+	//writers copy the current one, change the copy and swap it in.
+	struct OutfitCatalog
+	{
+		std::string groupDir;
+		std::vector<Outfit> outfits;
+		OutfitGroupMap groups;
+		IndexVec liveIndices; //Outfits that haven't been removed by a reload
+		OutfitIDMap idIndices; //Live outfits by stable id
+		OutfitLayerMap layerDependents; //Layered outfits by the id of each layer they name, may hold stale entries
+		AliasTable aliasTable;
+		std::set<FormID> ignoredFormIDs;
+		ContextRuleSetPtr contextRules; //Null without rules
+		ContextBucketsPtr contextBuckets; //Null without rules, shared by snapshots until the matched outfits change
+		unsigned int historyWindow;
+		unsigned int version;
+		bool lazyGroupLoading;
+		OutfitCatalog();
+	};
+
+	typedef std::shared_ptr<const OutfitCatalog> CatalogPtr;
+
+	//Catalog shuffle, replaced whole when the seed or catalog version changes
+	struct ShuffleCache
+	{
+		unsigned int version;
+		unsigned int seed;
+		IndexVec indices;
+	};
+
+	typedef std::shared_ptr<const ShuffleCache> ShuffleCachePtr;
+
+	//Group and context playlists, keyed by seed and sorted group set or context key
+	struct GroupPlaylist
+	{
+		unsigned int version;
+		IndexVec outfitIndices;
+		std::unordered_map<unsigned int, unsigned int> positions;
+	};
+
+	typedef std::shared_ptr<const GroupPlaylist> PlaylistPtr;
+
+	CatalogPtr getCatalog();
+
+	//With lazy group loading, resolves the group's forms the first time they are needed.
+	//Indices never change, returns the catalog to read the forms from.
+	CatalogPtr materializeOutfitGroup(const std::string& group_name);
+	CatalogPtr materializeOutfit(unsigned int index);
+
+	//Writers, serialized against each other
+	void LoadCatalog(const std::string& group_dir, const Json::Value& config_json);
+	void ClearCatalog(); //Publishes an empty catalog
+	void ReloadGroupFiles(const GroupFileChanges& changes);
+	bool registerOutfit(Outfit outfit, const std::string& group_name, unsigned int& index_out);
+	int replaceOutfitForms(const std::string& group_name, const std::string& outfit_name, const FormVec& forms);
+	int renameOutfit(const std::string& group_name, const std::string& outfit_name, const std::string& new_name);
+
+	//Republishes the catalog with tight allocations and releases tombstoned outfits and cached playlists.
+	//Slots never move, so every outfit index stays valid. Returns the estimated bytes freed.
+	std::size_t CompactCatalog();
+
+	//Memory accounting
+	void addCatalogMemoryUsage(const OutfitCatalog& catalog, MemoryUsage& usage);
+	void addCacheMemoryUsage(MemoryUsage& usage);
+
+	//Writes the group back to its file in the catalog's group directory
+	void saveGroupFile(const OutfitCatalog& catalog, const OutfitGroup& group);
+
+	//Group file weights, 1 if missing and 0 if invalid
+	float readWeight(const Json::Value& json, const std::string& context);
+
+	//Lookup
+	int getOutfitIndex(const OutfitCatalog& catalog, const std::string& group_name, const std::string& outfit_name);
+
+	//Case-insensitive, like the name lookup. Never 0.
+	std::uint64_t getOutfitID(const std::string& group_name, const std::string& outfit_name);
+	int getOutfitIndexByID(const OutfitCatalog& catalog, std::uint64_t outfit_id);
+
+	//Same answer as getOutfitIndex, through the id table unless another spelling of the name holds the id
+	int findOutfitIndex(const OutfitCatalog& catalog, std::uint64_t outfit_id, const std::string& group_name, const std::string& outfit_name);
+
+	bool outfitFormsAreTheSame(const Outfit& outfit1, const Outfit& outfit2);
+
+	//Combines the forms' slot masks and works out their equip order, forms keep their order.
+	//Pieces covering more slots go first so a smaller piece sharing a slot ends up equipped,
+	//forms without slots go last. Pieces sharing slots are logged with warn_conflicts.
+	void prepareOutfitForms(Outfit& outfit, bool warn_conflicts);
+
+	inline const FormVec& getEquipForms(const Outfit& outfit)
+	{
+		return outfit.equipForms.empty() ? outfit.forms : outfit.equipForms;
+	}
+
+	//Playlists
+	void shuffleIndices(const IndexVec& indices, unsigned int seed, IndexVec& shuffled_out);
+	ShuffleCachePtr shuffleOutfits(const OutfitCatalog& catalog, unsigned int seed);
+	PlaylistPtr getCachedPlaylist(const OutfitCatalog& catalog, const std::string& key, const IndexVec& indices, int seed);
+	PlaylistPtr getGroupPlaylist(const OutfitCatalog& catalog, const std::vector<std::string>& group_names, int seed);
+
+	//Playlist positions as the natives see them, a negative seed means catalog order of the live outfits
+	int getShuffledOutfitIndex(const OutfitCatalog& catalog, int shuffle_index, int seed);
+	int getOutfitShuffleIndex(const OutfitCatalog& catalog, int index, int seed);
+	int getGroupShuffledOutfitIndex(const OutfitCatalog& catalog, const std::vector<std::string>& group_names, int shuffle_index, int seed);
+	int getGroupOutfitShuffleIndex(const OutfitCatalog& catalog, const std::vector<std::string>& group_names, int index, int seed);
+
+	//Weighted selection
+	std::uint64_t mixSeed(unsigned int seed, unsigned int draw_index);
+	int sampleAliasTable(const AliasTable& table, std::uint64_t random);
+
+	//Draws from the group's table, or the catalog table if group_name is empty
+	int getWeightedOutfitIndex(const OutfitCatalog& catalog, const std::string& group_name, int draw_index, int seed);
+}
@@ -0,0 +1,206 @@
+#include "ContextRules.h"
+#include "CoreUtil.h"
+#include "LogCategories.h"
+#include "MemoryUsage.h"
+
+#include <algorithm>
+#include <map>
+
+namespace OutfitPlaylist
+{
+	const char* const ContextWeatherNames[] = { "clear", "cloudy", "rain", "snow" };
+	const char* const ContextTimeNames[] = { "morning", "day", "evening", "night" };
+
+	ContextRule::ContextRule()
+		: interiorMask(0x3), combatMask(0x3), timeMask(0xF), weatherMask(0xF) {}
+
+	bool parseContextMask(const Json::Value& json, const char* const names[], unsigned int num_names, std::uint8_t& mask_out)
+	{
+		if (json.isNull())
+			return true; //Keep the match-all default
+
+		std::vector<std::string> values;
+		if (json.isString())
+			values.push_back(json.asString());
+		else {
+			for (unsigned int i = 0u; i < json.size(); i++)
+				values.push_back(json[i].asString());
+		}
+
+		mask_out = 0u;
+		for (const std::string& value : values) {
+			unsigned int k = 0u;
+			while (k < num_names && !equalsIgnoreCase(value, names[k]))
+				k++;
+
+			if (k == num_names) {
+				spdlog::error("Unknown context rule value {}", value);
+				return false;
+			}
+			mask_out |= static_cast<std::uint8_t>(1u << k);
+		}
+		return mask_out != 0u;
+	}
+
+	bool parseContextFlag(const Json::Value& json, std::uint8_t& mask_out)
+	{
+		if (json.isNull())
+			return true;
+		if (!json.isBool())
+			return false;
+		mask_out = json.asBool() ? 0x2 : 0x1;
+		return true;
+	}
+
+	void loadContextRules(OutfitCatalog& catalog, const Json::Value& rules_json)
+	{
+		catalog.contextRules.reset();
+		catalog.contextBuckets.reset();
+		if (!rules_json.isArray())
+			return;
+
+		std::shared_ptr<ContextRuleSet> rule_set = std::make_shared<ContextRuleSet>();
+
+		for (unsigned int i = 0u; i < rules_json.size(); i++) {
+			const Json::Value& rule_json = rules_json[i];
+			ContextRule rule;
+
+			const Json::Value& groups_json = rule_json["groups"];
+			for (unsigned int k = 0u; k < groups_json.size(); k++)
+				rule.groupNames.push_back(groups_json[k].asString());
+
+			const Json::Value& outfits_json = rule_json["outfits"];
+			if (outfits_json.isObject()) {
+				for (Json::Value::const_iterator it = outfits_json.begin(); it != outfits_json.end(); ++it) {
+					for (unsigned int k = 0u; k < it->size(); k++)
+						rule.outfitNames.push_back(std::pair<std::string, std::string>(it.key().asString(), (*it)[k].asString()));
+				}
+			}
+
+			if (!parseContextFlag(rule_json["interior"], rule.interiorMask) ||
+				!parseContextFlag(rule_json["combat"], rule.combatMask) ||
+				!parseContextMask(rule_json["time"], ContextTimeNames, 4u, rule.timeMask) ||
+				!parseContextMask(rule_json["weather"], ContextWeatherNames, 4u, rule.weatherMask)) {
+				spdlog::error("Invalid context rule {}", i);
+				continue;
+			}
+
+			//Location keywords share one slot table across all rules
+			std::vector<std::string>& keywords = rule_set->locationKeywords;
+			const Json::Value& location_json = rule_json["location"];
+			for (unsigned int k = 0u; k < location_json.size(); k++) {
+				std::string keyword = location_json[k].asString();
+				std::vector<std::string>::iterator kw_it = std::find(keywords.begin(), keywords.end(), keyword);
+				unsigned int slot = static_cast<unsigned int>(kw_it - keywords.begin()) + 1u;
+				if (kw_it == keywords.end())
+					keywords.push_back(keyword);
+				rule.locationSlots.push_back(slot);
+			}
+
+			rule_set->rules.push_back(rule);
+		}
+
+		OPL_INFO(LogCategory::kContext, "Loaded {} context rules with {} location keywords", rule_set->rules.size(), rule_set->locationKeywords.size());
+		catalog.contextRules = rule_set;
+		compileContextRules(catalog);
+	}
+
+	bool contextRuleMatches(const ContextRule& rule, unsigned int key)
+	{
+		unsigned int location_slot = key / CONTEXT_BASE_COUNT;
+		if (!((rule.interiorMask >> (key & 0x1u)) & 0x1u) ||
+			!((rule.combatMask >> ((key >> 1) & 0x1u)) & 0x1u) ||
+			!((rule.timeMask >> ((key >> 2) & 0x3u)) & 0x1u) ||
+			!((rule.weatherMask >> ((key >> 4) & 0x3u)) & 0x1u))
+			return false;
+
+		return rule.locationSlots.empty() || std::find(rule.locationSlots.begin(), rule.locationSlots.end(), location_slot) != rule.locationSlots.end();
+	}
+
+	//Rule outfits are only reported missing when the rules are first compiled
+	void resolveContextRule(const OutfitCatalog& catalog, unsigned int rule_index, bool warn, IndexVec& indices_out)
+	{
+		const ContextRule& rule = catalog.contextRules->rules[rule_index];
+		for (unsigned int k = 0u; k < rule.groupNames.size(); k++) {
+			OutfitGroupMap::const_iterator group_it = catalog.groups.find(rule.groupNames[k]);
+			if (group_it != catalog.groups.end())
+				indices_out.insert(indices_out.end(), group_it->second.outfitIndices.begin(), group_it->second.outfitIndices.end());
+			else if (warn)
+				spdlog::warn("Context rule {} group not found: {}", rule_index, rule.groupNames[k]);
+		}
+		for (unsigned int k = 0u; k < rule.outfitNames.size(); k++) {
+			int outfit_index = getOutfitIndex(catalog, rule.outfitNames[k].first, rule.outfitNames[k].second);
+			if (outfit_index >= 0)
+				indices_out.push_back(static_cast<unsigned int>(outfit_index));
+			else if (warn)
+				spdlog::warn("Context rule {} outfit not found: {}:{}", rule_index, rule.outfitNames[k].first, rule.outfitNames[k].second);
+		}
+	}
+
+	void compileContextRules(OutfitCatalog& catalog)
+	{
+		if (!catalog.contextRules || catalog.contextRules->rules.empty()) {
+			catalog.contextBuckets.reset();
+			return;
+		}
+
+		const std::vector<ContextRule>& rules = catalog.contextRules->rules;
+		std::shared_ptr<ContextBuckets> compiled = std::make_shared<ContextBuckets>();
+		compiled->ruleOutfits.resize(rules.size());
+		for (unsigned int i = 0u; i < rules.size(); i++)
+			resolveContextRule(catalog, i, !catalog.contextBuckets, compiled->ruleOutfits[i]);
+
+		if (catalog.contextBuckets && catalog.contextBuckets->ruleOutfits == compiled->ruleOutfits)
+			return; //Same outfits, snapshots keep sharing the buckets
+
+		//Keys with the same outfits share a list, so do lists that didn't change since the last compile
+		std::map<IndexVec, ContextBucketPtr> distinct_buckets;
+		if (catalog.contextBuckets) {
+			for (const ContextBucketPtr& bucket : catalog.contextBuckets->buckets)
+				distinct_buckets.insert(std::pair<IndexVec, ContextBucketPtr>(*bucket, bucket));
+		}
+
+		compiled->buckets.resize(CONTEXT_BASE_COUNT * (catalog.contextRules->locationKeywords.size() + 1u));
+		IndexVec indices;
+		for (unsigned int key = 0u; key < compiled->buckets.size(); key++) {
+			indices.clear();
+			for (unsigned int i = 0u; i < rules.size(); i++) {
+				if (contextRuleMatches(rules[i], key))
+					indices.insert(indices.end(), compiled->ruleOutfits[i].begin(), compiled->ruleOutfits[i].end());
+			}
+
+			//Remove outfits matched by more than one rule
+			std::sort(indices.begin(), indices.end());
+			indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+			std::map<IndexVec, ContextBucketPtr>::iterator bucket_it = distinct_buckets.find(indices);
+			if (bucket_it == distinct_buckets.end())
+				bucket_it = distinct_buckets.insert(std::pair<IndexVec, ContextBucketPtr>(indices, std::make_shared<const IndexVec>(indices))).first;
+			compiled->buckets[key] = bucket_it->second;
+		}
+
+		catalog.contextBuckets = compiled;
+	}
+
+	void addContextMemoryUsage(const OutfitCatalog& catalog, MemoryUsage& usage)
+	{
+		if (catalog.contextRules) {
+			usage.context += sizeof(ContextRuleSet) + getVectorHeapBytes(catalog.contextRules->rules) + getVectorHeapBytes(catalog.contextRules->locationKeywords);
+			for (const std::string& keyword : catalog.contextRules->locationKeywords)
+				usage.context += getStringHeapBytes(keyword);
+		}
+
+		if (catalog.contextBuckets) {
+			usage.context += sizeof(ContextBuckets) + getVectorHeapBytes(catalog.contextBuckets->ruleOutfits) + getVectorHeapBytes(catalog.contextBuckets->buckets);
+			for (const IndexVec& rule_outfits : catalog.contextBuckets->ruleOutfits)
+				usage.context += getVectorHeapBytes(rule_outfits);
+
+			//Each shared list once
+			std::unordered_set<const void*> seen_buckets;
+			for (const ContextBucketPtr& bucket : catalog.contextBuckets->buckets) {
+				if (seen_buckets.insert(bucket.get()).second)
+					usage.context += 2u * sizeof(void*) + sizeof(IndexVec) + getVectorHeapBytes(*bucket);
+			}
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Catalog.h"
+
+namespace OutfitPlaylist
+{
+	enum ContextWeather { kWeatherClear = 0, kWeatherCloudy, kWeatherRain, kWeatherSnow };
+	enum ContextTime { kTimeMorning = 0, kTimeDay, kTimeEvening, kTimeNight };
+
+	//Context key layout: interior(1) | combat(1) | time(2) | weather(2), then one block of these per location slot
+	const unsigned int CONTEXT_BASE_COUNT = 64u;
+
+	struct ContextRule
+	{
+		std::vector<std::string> groupNames;
+		std::vector<std::pair<std::string, std::string>> outfitNames;
+		std::uint8_t interiorMask;
+		std::uint8_t combatMask;
+		std::uint8_t timeMask;
+		std::uint8_t weatherMask;
+		std::vector<unsigned int> locationSlots; //Empty matches any location
+		ContextRule();
+	};
+
+	//The config rules, kept by every catalog loaded with them
+	struct ContextRuleSet
+	{
+		std::vector<ContextRule> rules;
+		std::vector<std::string> locationKeywords; //Slot 0 is "no configured keyword", slot i+1 is keyword i
+	};
+
+	//Buckets are shared between compiles, only a bucket whose outfits changed is allocated again
+	struct ContextBuckets
+	{
+		std::vector<IndexVec> ruleOutfits; //What each rule matched when compiled
+		std::vector<ContextBucketPtr> buckets; //One per context key
+	};
+
+	//Parses the config rules into the catalog and compiles them
+	void loadContextRules(OutfitCatalog& catalog, const Json::Value& rules_json);
+
+	//Fills the catalog's context buckets, keeps the current ones if no rule matches different outfits
+	void compileContextRules(OutfitCatalog& catalog);
+
+	void addContextMemoryUsage(const OutfitCatalog& catalog, MemoryUsage& usage);
+}
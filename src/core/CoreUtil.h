@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <json/json.h>
+
+namespace OutfitPlaylist
+{
+	inline bool equalsIgnoreCase(const std::string& str1, const std::string& str2)
+	{
+		return std::equal(str1.begin(), str1.end(), str2.begin(), str2.end(), [](unsigned char ch1, unsigned char ch2) {
+			return std::tolower(ch1) == std::tolower(ch2);
+		});
+	}
+
+	inline std::string toLowercase(const std::string& str)
+	{
+		std::string result = str;
+		std::transform(result.begin(), result.end(), result.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+		return result;
+	}
+
+	//Cosave keys, reads both the "0x" prefixed and bare hex forms
+	inline std::string formIDToString(std::uint32_t form_id)
+	{
+		char buffer[16];
+		std::snprintf(buffer, sizeof(buffer), "0x%08X", form_id);
+		return buffer;
+	}
+
+	inline std::uint32_t stringToFormID(const std::string& str)
+	{
+		return static_cast<std::uint32_t>(std::strtoul(str.c_str(), NULL, 16));
+	}
+
+	//FNV-1a, stable across runs and platforms
+	const std::uint64_t HASH_SEED = 14695981039346656037ull;
+
+	inline std::uint64_t hashBytes(const void* data, std::size_t size, std::uint64_t hash = HASH_SEED)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (std::size_t i = 0u; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	//Stable outfit ids are passed to Papyrus as 16 hex digits, it has no 64 bit integers
+	inline std::string outfitIDToString(std::uint64_t outfit_id)
+	{
+		char buffer[24];
+		std::snprintf(buffer, sizeof(buffer), "%016llX", static_cast<unsigned long long>(outfit_id));
+		return buffer;
+	}
+
+	inline std::uint64_t stringToOutfitID(const std::string& str)
+	{
+		return static_cast<std::uint64_t>(std::strtoull(str.c_str(), NULL, 16));
+	}
+
+	inline void tryGetString(const Json::Value& json, std::string& out)
+	{
+		if (json.isString())
+			out = json.asString();
+	}
+
+	inline void tryGetBool(const Json::Value& json, bool& out)
+	{
+		if (json.isBool())
+			out = json.asBool();
+	}
+}
@@ -0,0 +1,125 @@
+#include "FormFilter.h"
+#include "CoreUtil.h"
+#include "LogCategories.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace OutfitPlaylist
+{
+	const char* const FormRejectionNames[] = {
+		"invalid",
+		"not found",
+		"wrong type"
+	};
+
+	static_assert(sizeof(FormRejectionNames) / sizeof(FormRejectionNames[0]) == kRejectNumRejections);
+
+	const std::size_t MAX_REJECTION_EXAMPLES = 8u;
+	const std::size_t FORMS_PER_FILTER_THREAD = 16384u; //Smaller loads aren't worth starting threads for
+
+	FormRejections::FormRejections()
+		: counts() {}
+
+	void addFormRejection(FormRejections& rejections, FormRejection rejection, const Outfit& outfit, const std::string& reference)
+	{
+		rejections.counts[rejection]++;
+		if (rejections.examples.size() < MAX_REJECTION_EXAMPLES)
+			rejections.examples.push_back(fmt::format("{} {}/{}: {}", FormRejectionNames[rejection], outfit.groupName, outfit.name, reference));
+	}
+
+	void logFormRejections(const FormRejections& rejections, const std::string& context)
+	{
+		unsigned int total = 0u;
+		for (unsigned int i = 0u; i < kRejectNumRejections; i++)
+			total += rejections.counts[i];
+		if (total == 0u)
+			return;
+
+		spdlog::error("Skipped {} outfit forms loading {}: {} {}, {} {}, {} {}", total, context,
+			rejections.counts[kRejectInvalid], FormRejectionNames[kRejectInvalid],
+			rejections.counts[kRejectNotFound], FormRejectionNames[kRejectNotFound],
+			rejections.counts[kRejectWrongType], FormRejectionNames[kRejectWrongType]);
+		for (const std::string& example : rejections.examples)
+			spdlog::error("  {}", example);
+		if (total > rejections.examples.size())
+			spdlog::error("  and {} more", total - rejections.examples.size());
+	}
+
+	//One bit per form type
+	struct FormTypeMask
+	{
+		std::uint64_t bits[4];
+	};
+
+	void buildOutfitFormTypeMask(const FormResolver* resolver, FormTypeMask& mask_out)
+	{
+		for (unsigned int i = 0u; i < 4u; i++)
+			mask_out.bits[i] = 0u;
+		for (unsigned int form_type = 0u; form_type < 256u; form_type++) {
+			if (resolver->isOutfitFormType(static_cast<std::uint8_t>(form_type)))
+				mask_out.bits[form_type >> 6] |= 1ull << (form_type & 63u);
+		}
+	}
+
+	//Gathers the types of forms [begin, end) and tests them against the mask
+	void classifyFormRange(const FormResolver* resolver, const FormTypeMask& mask, const std::vector<GameForm*>& forms, std::vector<std::uint8_t>& form_types, std::vector<std::uint8_t>& accepted, std::size_t begin, std::size_t end)
+	{
+		for (std::size_t i = begin; i < end; i++)
+			form_types[i] = resolver->getFormType(forms[i]);
+		for (std::size_t i = begin; i < end; i++)
+			accepted[i] = static_cast<std::uint8_t>((mask.bits[form_types[i] >> 6] >> (form_types[i] & 63u)) & 1u);
+	}
+
+	void filterOutfitForms(const std::vector<Outfit*>& outfits, FormRejections& rejections)
+	{
+		FormResolver* resolver = getFormResolver();
+
+		std::size_t form_count = 0u;
+		for (const Outfit* outfit : outfits)
+			form_count += outfit->forms.size();
+		if (form_count == 0u)
+			return;
+
+		std::vector<GameForm*> forms;
+		forms.reserve(form_count);
+		for (const Outfit* outfit : outfits)
+			forms.insert(forms.end(), outfit->forms.begin(), outfit->forms.end());
+
+		FormTypeMask mask;
+		buildOutfitFormTypeMask(resolver, mask);
+
+		std::vector<std::uint8_t> form_types(form_count);
+		std::vector<std::uint8_t> accepted(form_count);
+		std::size_t thread_count = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), (form_count + FORMS_PER_FILTER_THREAD - 1u) / FORMS_PER_FILTER_THREAD);
+		if (thread_count <= 1u)
+			classifyFormRange(resolver, mask, forms, form_types, accepted, 0u, form_count);
+		else {
+			std::size_t chunk_size = (form_count + thread_count - 1u) / thread_count;
+			std::vector<std::jthread> threads;
+			for (std::size_t begin = 0u; begin < form_count; begin += chunk_size) {
+				std::size_t end = std::min(begin + chunk_size, form_count);
+				threads.emplace_back([&, begin, end]() {
+					classifyFormRange(resolver, mask, forms, form_types, accepted, begin, end);
+				});
+			}
+		}
+
+		//Compact each outfit in place, the flags are in gather order
+		std::size_t form_index = 0u;
+		for (Outfit* outfit : outfits) {
+			std::size_t kept = 0u;
+			for (GameForm* form : outfit->forms) {
+				if (accepted[form_index++]) {
+					outfit->forms[kept++] = form;
+					continue;
+				}
+
+				Json::Value reference_json;
+				resolver->serializeForm(form, reference_json);
+				addFormRejection(rejections, kRejectWrongType, *outfit, reference_json.isString() ? reference_json.asString() : formIDToString(resolver->getFormID(form)));
+			}
+			outfit->forms.resize(kept);
+		}
+	}
+}
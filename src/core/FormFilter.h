@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Catalog.h"
+
+#include <string>
+#include <vector>
+
+namespace OutfitPlaylist
+{
+	//Why a group file reference was left out of its outfit, names are in FormRejectionNames
+	enum FormRejection
+	{
+		kRejectInvalid = 0,
+		kRejectNotFound,
+		kRejectWrongType,
+		kRejectNumRejections
+	};
+
+	//Rejected references of one load, logged together when the load is done
+	struct FormRejections
+	{
+		unsigned int counts[kRejectNumRejections];
+		std::vector<std::string> examples; //The first few
+		FormRejections();
+	};
+
+	void addFormRejection(FormRejections& rejections, FormRejection rejection, const Outfit& outfit, const std::string& reference);
+	void logFormRejections(const FormRejections& rejections, const std::string& context);
+
+	//Drops the forms that aren't outfit forms from the outfits' form lists. The form types of
+	//every outfit are gathered into one array and tested against a mask of accepted types,
+	//on worker threads for large loads.
+	void filterOutfitForms(const std::vector<Outfit*>& outfits, FormRejections& rejections);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <json/json.h>
+
+//The core only handles forms through pointers and the resolver below, so it builds
+//against either the game's forms or the in-memory fakes
+#ifdef OPL_HEADLESS
+namespace OutfitPlaylist
+{
+	struct FakeForm;
+	typedef FakeForm GameForm;
+	typedef std::uint32_t FormID;
+}
+#else
+#include <RE/Skyrim.h>
+
+namespace OutfitPlaylist
+{
+	typedef RE::TESForm GameForm;
+	typedef RE::FormID FormID;
+}
+#endif
+
+namespace OutfitPlaylist
+{
+	enum ActorStatus
+	{
+		kActorMissing,
+		kActorDeleted,
+		kActorPresent
+	};
+
+	//Game data the core reads, the plugin implements it on top of TESDataHandler
+	class FormResolver
+	{
+	public:
+		virtual ~FormResolver() {}
+
+		//Group and config file form references. Returns false if the reference can't be parsed,
+		//form_out is NULL if it parsed but the form isn't loaded.
+		virtual bool deserializeForm(const Json::Value& json, GameForm*& form_out) const = 0;
+		virtual void serializeForm(const GameForm* form, Json::Value& json_out) const = 0;
+
+		//Splits a reference into its plugin and plugin local form id without looking it up
+		virtual bool parseFormReference(const Json::Value& json, std::string& mod_name_out, FormID& local_form_id_out) const = 0;
+		virtual bool isPluginLoaded(const std::string& mod_name) const = 0;
+
+		//NULL if the plugin or form isn't loaded
+		virtual GameForm* lookupPluginForm(const std::string& mod_name, FormID local_form_id) const = 0;
+
+		virtual GameForm* lookupForm(FormID form_id) const = 0;
+		virtual FormID getFormID(const GameForm* form) const = 0;
+		virtual bool actorExists(FormID actor_id) const = 0;
+		virtual ActorStatus getActorStatus(FormID actor_id) const = 0;
+
+		//Armor, weapons, ammo and lights. Form types fit in a byte, so bulk loads gather them
+		//and test them against a mask built from isOutfitFormType.
+		virtual std::uint8_t getFormType(const GameForm* form) const = 0;
+		virtual bool isOutfitFormType(std::uint8_t form_type) const = 0;
+
+		bool isOutfitForm(const GameForm* form) const
+		{
+			return isOutfitFormType(getFormType(form));
+		}
+
+		//Biped slots the form occupies, 0 for weapons and other forms without slots
+		virtual std::uint32_t getSlotMask(const GameForm* form) const = 0;
+	};
+
+	//Cosave records, the plugin implements it on top of SKSE::SerializationInterface
+	class RecordSerializer
+	{
+	public:
+		virtual ~RecordSerializer() {}
+
+		virtual bool getNextRecordInfo(std::uint32_t& type, std::uint32_t& version, std::uint32_t& length) = 0;
+		virtual bool readRecordJson(Json::Value& json_out) = 0;
+		virtual bool readRecordData(std::string& data_out, std::uint32_t length) = 0;
+
+		virtual bool openRecord(std::uint32_t type, std::uint32_t version) = 0;
+		virtual bool writeRecordJson(const Json::Value& json) = 0;
+		virtual bool writeRecordData(const std::string& data) = 0;
+
+		//Maps a form id from the save's load order to the current one
+		virtual bool resolveFormID(FormID old_form_id, FormID& form_id_out) = 0;
+	};
+
+	void SetFormResolver(FormResolver* resolver);
+	FormResolver* getFormResolver();
+}
@@ -0,0 +1,142 @@
+#include "GroupWatcher.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+
+namespace OutfitPlaylist
+{
+	std::string sWatchedDir;
+	GroupFileStateMap sWatchedState;
+	GroupFileChanges sPendingChanges;
+	std::mutex sWatcherMutex;
+	std::condition_variable_any sWatcherWake; //Also woken by a stop request
+	std::jthread sWatcherThread; //Stopped and joined on exit if StopGroupWatcher wasn't called
+
+	bool GroupFileChanges::empty() const
+	{
+		return changed.empty() && removed.empty();
+	}
+
+	void addUnique(std::vector<std::string>& paths, const std::string& path)
+	{
+		if (std::find(paths.begin(), paths.end(), path) == paths.end())
+			paths.push_back(path);
+	}
+
+	void removePath(std::vector<std::string>& paths, const std::string& path)
+	{
+		paths.erase(std::remove(paths.begin(), paths.end(), path), paths.end());
+	}
+
+	void scanGroupFiles(const std::string& dir, GroupFileStateMap& state, GroupFileChanges& changes_out)
+	{
+		std::error_code error;
+		GroupFileStateMap current;
+		for (std::filesystem::directory_iterator it(dir, error), end; !error && it != end; it.increment(error)) {
+			std::string file_name = it->path().filename().string();
+			if (!file_name.ends_with(".json"))
+				continue;
+
+			GroupFileState file_state;
+			file_state.writeTime = it->last_write_time(error);
+			file_state.size = it->file_size(error);
+			if (error) {
+				//File vanished between listing and stat, pick it up next scan
+				error.clear();
+				continue;
+			}
+			current[file_name] = file_state;
+		}
+
+		for (GroupFileStateMap::iterator it = current.begin(); it != current.end(); ++it) {
+			GroupFileStateMap::iterator old_it = state.find(it->first);
+			if (old_it == state.end() || old_it->second.writeTime != it->second.writeTime || old_it->second.size != it->second.size) {
+				addUnique(changes_out.changed, it->first);
+				removePath(changes_out.removed, it->first);
+			}
+		}
+
+		for (GroupFileStateMap::iterator it = state.begin(); it != state.end(); ++it) {
+			if (!current.contains(it->first)) {
+				addUnique(changes_out.removed, it->first);
+				removePath(changes_out.changed, it->first);
+			}
+		}
+
+		state.swap(current);
+	}
+
+	void StartGroupWatcher(const std::string& dir, std::chrono::milliseconds interval, std::function<void()> on_change)
+	{
+		StopGroupWatcher();
+		{
+			std::lock_guard<std::mutex> lock(sWatcherMutex);
+			sWatchedDir = dir;
+			sWatchedState.clear();
+			sPendingChanges = GroupFileChanges();
+
+			//Files already loaded are the baseline, not changes
+			GroupFileChanges initial;
+			scanGroupFiles(sWatchedDir, sWatchedState, initial);
+		}
+
+		sWatcherThread = std::jthread([interval, on_change](std::stop_token stop_token) {
+			std::unique_lock<std::mutex> lock(sWatcherMutex);
+			while (!sWatcherWake.wait_for(lock, stop_token, interval, [&stop_token]() { return stop_token.stop_requested(); })) {
+				//Only notify when changes become pending, a queued notification will take later ones too
+				bool was_pending = !sPendingChanges.empty();
+				scanGroupFiles(sWatchedDir, sWatchedState, sPendingChanges);
+				if (was_pending || sPendingChanges.empty())
+					continue;
+
+				lock.unlock();
+				on_change();
+				lock.lock();
+			}
+		});
+	}
+
+	void StopGroupWatcher()
+	{
+		//Waits for a scan or on_change in progress, unless on_change is the one stopping
+		if (sWatcherThread.joinable() && sWatcherThread.get_id() != std::this_thread::get_id()) {
+			sWatcherThread.request_stop();
+			sWatcherThread.join();
+		}
+		else
+			sWatcherThread.request_stop();
+
+		{
+			std::lock_guard<std::mutex> lock(sWatcherMutex);
+			sWatchedDir.clear();
+			sWatchedState.clear();
+			sPendingChanges = GroupFileChanges();
+		}
+	}
+
+	bool takeGroupFileChanges(GroupFileChanges& changes_out)
+	{
+		std::lock_guard<std::mutex> lock(sWatcherMutex);
+		changes_out = sPendingChanges;
+		sPendingChanges = GroupFileChanges();
+		return !changes_out.empty();
+	}
+
+	void refreshGroupFileState(const std::string& path)
+	{
+		std::lock_guard<std::mutex> lock(sWatcherMutex);
+		if (sWatchedDir.empty())
+			return;
+
+		std::error_code error;
+		GroupFileState file_state;
+		file_state.writeTime = std::filesystem::last_write_time(path, error);
+		if (!error)
+			file_state.size = std::filesystem::file_size(path, error);
+		if (!error)
+			sWatchedState[std::filesystem::path(path).filename().string()] = file_state;
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace OutfitPlaylist
+{
+	struct GroupFileState
+	{
+		std::filesystem::file_time_type writeTime;
+		std::uintmax_t size;
+	};
+
+	//Keyed by group file name
+	typedef std::map<std::string, GroupFileState> GroupFileStateMap;
+
+	struct GroupFileChanges
+	{
+		std::vector<std::string> changed; //Added or modified file names
+		std::vector<std::string> removed;
+		bool empty() const;
+	};
+
+	//Compare the directory against the last known state, update it and collect what changed
+	void scanGroupFiles(const std::string& dir, GroupFileStateMap& state, GroupFileChanges& changes_out);
+
+	//Polling watcher thread. on_change is called from the watcher thread when changes are pending.
+	//Starting again replaces the running watcher.
+	void StartGroupWatcher(const std::string& dir, std::chrono::milliseconds interval, std::function<void()> on_change);
+
+	//Stops the watcher thread and waits for it to exit
+	void StopGroupWatcher();
+	bool takeGroupFileChanges(GroupFileChanges& changes_out);
+
+	//Record a file we wrote ourselves so it isn't reported back as a change
+	void refreshGroupFileState(const std::string& path);
+}
@@ -0,0 +1,68 @@
+#include "LogCategories.h"
+
+#include <spdlog/async.h>
+#include <spdlog/sinks/basic_file_sink.h>
+
+#include <string>
+#include <vector>
+
+const char* const LogCategoryNames[] = { "general", "outfits", "groups", "context", "save", "perf" };
+std::shared_ptr<spdlog::logger> sCategoryLoggers[static_cast<int>(LogCategory::kTotal)];
+
+//Problems go to warnings_out, the category loggers don't exist yet
+spdlog::level::level_enum readLogLevel(const Json::Value& json, spdlog::level::level_enum default_level, std::vector<std::string>& warnings_out)
+{
+	if (!json.isString())
+		return default_level;
+
+	//from_str returns off for names it doesn't know
+	spdlog::level::level_enum level = spdlog::level::from_str(json.asString());
+	if (level == spdlog::level::off && json.asString() != "off") {
+		warnings_out.push_back(fmt::format("Unknown log level {}", json.asString()));
+		return default_level;
+	}
+	return level;
+}
+
+void setupLogCategories(const std::filesystem::path& log_path, const Json::Value& log_json)
+{
+	auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(log_path.string(), true);
+
+	std::vector<std::string> warnings;
+	spdlog::level::level_enum level = readLogLevel(log_json["level"], spdlog::level::info, warnings);
+	bool async = log_json["async"].isBool() ? log_json["async"].asBool() : true;
+
+	//Bounded queue, a full queue drops the oldest message rather than stalling the game thread
+	if (async) {
+		unsigned int queue_size = log_json["queueSize"].isUInt() ? log_json["queueSize"].asUInt() : 8192u;
+		spdlog::init_thread_pool(std::max(queue_size, 128u), 1);
+	}
+
+	for (int i = 0; i < static_cast<int>(LogCategory::kTotal); i++) {
+		std::shared_ptr<spdlog::logger> logger;
+		if (async)
+			logger = std::make_shared<spdlog::async_logger>(LogCategoryNames[i], file_sink, spdlog::thread_pool(), spdlog::async_overflow_policy::overrun_oldest);
+		else
+			logger = std::make_shared<spdlog::logger>(LogCategoryNames[i], file_sink);
+
+		logger->set_level(readLogLevel(log_json["categories"][LogCategoryNames[i]], level, warnings));
+		logger->flush_on(spdlog::level::warn);
+		spdlog::register_logger(logger);
+		sCategoryLoggers[i] = logger;
+	}
+
+	spdlog::set_default_logger(sCategoryLoggers[static_cast<int>(LogCategory::kGeneral)]);
+
+	//Everything below warn reaches the file on the background flush
+	int flush_interval = log_json["flushIntervalSeconds"].isInt() ? log_json["flushIntervalSeconds"].asInt() : 1;
+	spdlog::flush_every(std::chrono::seconds(std::max(flush_interval, 1)));
+
+	for (const std::string& warning : warnings)
+		OPL_WARN(LogCategory::kGeneral, "{}", warning);
+}
+
+spdlog::logger* getCategoryLogger(LogCategory category)
+{
+	spdlog::logger* logger = sCategoryLoggers[static_cast<int>(category)].get();
+	return logger ? logger : spdlog::default_logger_raw();
+}
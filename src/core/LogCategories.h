@@ -0,0 +1,35 @@
+#pragma once
+
+#include <filesystem>
+
+#include <spdlog/spdlog.h>
+#include <json/json.h>
+
+//Log subsystems, each can be given its own level under "logging.categories" in the config
+enum class LogCategory
+{
+	kGeneral = 0,
+	kOutfits,
+	kGroups,
+	kContext,
+	kSave,
+	kPerf,
+	kTotal
+};
+
+//Create the category loggers writing to log_path, general becomes the default logger
+void setupLogCategories(const std::filesystem::path& log_path, const Json::Value& log_json);
+spdlog::logger* getCategoryLogger(LogCategory category);
+
+//The level is checked before the arguments are evaluated, so a disabled level costs a compare
+#define OPL_LOG(category, level, ...) \
+	do { \
+		spdlog::logger* opl_logger = getCategoryLogger(category); \
+		if (opl_logger->should_log(level)) \
+			opl_logger->log(level, __VA_ARGS__); \
+	} while (0)
+
+#define OPL_TRACE(category, ...) OPL_LOG(category, spdlog::level::trace, __VA_ARGS__)
+#define OPL_DEBUG(category, ...) OPL_LOG(category, spdlog::level::debug, __VA_ARGS__)
+#define OPL_INFO(category, ...) OPL_LOG(category, spdlog::level::info, __VA_ARGS__)
+#define OPL_WARN(category, ...) OPL_LOG(category, spdlog::level::warn, __VA_ARGS__)
@@ -0,0 +1,50 @@
+#include "MemoryUsage.h"
+#include "ActorState.h"
+#include "Catalog.h"
+#include "LogCategories.h"
+
+namespace OutfitPlaylist
+{
+	MemoryUsage::MemoryUsage()
+		: outfits(0u), forms(0u), strings(0u), groups(0u), context(0u), actorState(0u), caches(0u), other(0u) {}
+
+	std::size_t MemoryUsage::getTotal() const
+	{
+		return outfits + forms + strings + groups + context + actorState + caches + other;
+	}
+
+	void getMemoryUsage(MemoryUsage& usage_out)
+	{
+		usage_out = MemoryUsage();
+		addCatalogMemoryUsage(*getCatalog(), usage_out);
+		addCacheMemoryUsage(usage_out);
+		addActorMemoryUsage(usage_out);
+	}
+
+	void getMemorySummary(std::vector<std::string>& lines_out)
+	{
+		MemoryUsage usage;
+		getMemoryUsage(usage);
+
+		lines_out.clear();
+		lines_out.push_back(fmt::format("Total: {} KB", usage.getTotal() / 1024u));
+		lines_out.push_back(fmt::format("Outfits: {} KB", usage.outfits / 1024u));
+		lines_out.push_back(fmt::format("Forms: {} KB", usage.forms / 1024u));
+		lines_out.push_back(fmt::format("Strings: {} KB", usage.strings / 1024u));
+		lines_out.push_back(fmt::format("Groups: {} KB", usage.groups / 1024u));
+		lines_out.push_back(fmt::format("Context: {} KB", usage.context / 1024u));
+		lines_out.push_back(fmt::format("ActorState: {} KB", usage.actorState / 1024u));
+		lines_out.push_back(fmt::format("Caches: {} KB", usage.caches / 1024u));
+		lines_out.push_back(fmt::format("Other: {} KB", usage.other / 1024u));
+	}
+
+	void logMemorySummary()
+	{
+		std::vector<std::string> lines;
+		getMemorySummary(lines);
+
+		OPL_INFO(LogCategory::kPerf, "Memory summary");
+		for (const std::string& line : lines)
+			OPL_INFO(LogCategory::kPerf, "{}", line);
+	}
+}
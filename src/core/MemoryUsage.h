@@ -0,0 +1,59 @@
+#pragma once
+
+#include "SharedName.h"
+
+#include <cstddef>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace OutfitPlaylist
+{
+	//Estimated heap bytes held by the plugin, container node overhead is approximated
+	struct MemoryUsage
+	{
+		std::size_t outfits; //Outfit slots, including tombstones and spare capacity
+		std::size_t forms; //Outfit form lists
+		std::size_t strings; //Outfit names that don't fit the small string buffer, shared names once each
+		std::size_t groups; //Group index lists and alias tables
+		std::size_t context; //Compiled context buckets and location keywords
+		std::size_t actorState; //Equipped outfit copies and history
+		std::size_t caches; //Shuffle and playlist caches
+		std::size_t other; //Ignored forms
+		MemoryUsage();
+		std::size_t getTotal() const;
+	};
+
+	//Rough size of a red-black tree or hash node on top of its value
+	const std::size_t MAP_NODE_OVERHEAD = 4u * sizeof(void*);
+
+	//Reference counts and the string itself, allocated together
+	const std::size_t SHARED_NAME_OVERHEAD = 2u * sizeof(void*) + sizeof(std::string);
+
+	typedef std::unordered_set<const void*> SharedNameSet;
+
+	inline std::size_t getStringHeapBytes(const std::string& str)
+	{
+		static const std::size_t small_capacity = std::string().capacity();
+		return str.capacity() > small_capacity ? str.capacity() + 1u : 0u;
+	}
+
+	//A shared name only counts the first time it is seen
+	inline std::size_t getSharedNameHeapBytes(const SharedName& name, SharedNameSet& seen)
+	{
+		if (!name.getKey() || !seen.insert(name.getKey()).second)
+			return 0u;
+		return SHARED_NAME_OVERHEAD + getStringHeapBytes(name.str());
+	}
+
+	template <class T>
+	std::size_t getVectorHeapBytes(const std::vector<T>& vec)
+	{
+		return vec.capacity() * sizeof(T);
+	}
+
+	//Current catalog, caches and actor state. Catalogs still held by readers aren't counted.
+	void getMemoryUsage(MemoryUsage& usage_out);
+	void getMemorySummary(std::vector<std::string>& lines_out);
+	void logMemorySummary();
+}
@@ -0,0 +1,673 @@
+#include "OutfitPack.h"
+#include "CoreUtil.h"
+#include "LogCategories.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <unordered_map>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace OutfitPlaylist
+{
+	const char PACK_MAGIC[4] = { 'O', 'P', 'L', 'K' };
+	const std::uint32_t PACK_VERSION = 1u;
+
+	//Read only view of a whole file, unmapped when it goes out of scope
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool open(const std::string& path);
+		const unsigned char* getData() const;
+		std::size_t getSize() const;
+
+	private:
+		const unsigned char* mData;
+		std::size_t mSize;
+#ifdef _WIN32
+		HANDLE mFile;
+		HANDLE mMapping;
+#endif
+	};
+
+#ifdef _WIN32
+	MappedFile::MappedFile()
+		: mData(NULL), mSize(0u), mFile(INVALID_HANDLE_VALUE), mMapping(NULL) {}
+
+	MappedFile::~MappedFile()
+	{
+		if (mData)
+			UnmapViewOfFile(mData);
+		if (mMapping)
+			CloseHandle(mMapping);
+		if (mFile != INVALID_HANDLE_VALUE)
+			CloseHandle(mFile);
+	}
+
+	bool MappedFile::open(const std::string& path)
+	{
+		mFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (mFile == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(mFile, &size))
+			return false;
+		mSize = static_cast<std::size_t>(size.QuadPart);
+		if (mSize == 0u)
+			return true; //Empty files can't be mapped
+
+		mMapping = CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!mMapping)
+			return false;
+
+		mData = static_cast<const unsigned char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+		return mData != NULL;
+	}
+#else
+	MappedFile::MappedFile()
+		: mData(NULL), mSize(0u) {}
+
+	MappedFile::~MappedFile()
+	{
+		if (mData)
+			munmap(const_cast<unsigned char*>(mData), mSize);
+	}
+
+	bool MappedFile::open(const std::string& path)
+	{
+		int file = ::open(path.c_str(), O_RDONLY);
+		if (file < 0)
+			return false;
+
+		struct stat file_stat;
+		if (fstat(file, &file_stat) != 0) {
+			close(file);
+			return false;
+		}
+
+		mSize = static_cast<std::size_t>(file_stat.st_size);
+		if (mSize == 0u) {
+			close(file);
+			return true; //Empty files can't be mapped
+		}
+
+		//The mapping stays valid after the descriptor is closed
+		void* data = mmap(NULL, mSize, PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);
+		if (data == MAP_FAILED)
+			return false;
+
+		mData = static_cast<const unsigned char*>(data);
+		return true;
+	}
+#endif
+
+	const unsigned char* MappedFile::getData() const
+	{
+		return mData;
+	}
+
+	std::size_t MappedFile::getSize() const
+	{
+		return mData ? mSize : 0u;
+	}
+
+	//Bounds checked cursor over a mapped pack
+	class PackReader
+	{
+	public:
+		PackReader(const unsigned char* data, std::size_t size);
+
+		bool readVarint(std::uint64_t& value_out);
+		bool readIndex(std::size_t table_size, unsigned int& index_out);
+		bool readCount(std::size_t& count_out); //Never more than the bytes left, every entry takes at least one
+		bool readU32(std::uint32_t& value_out);
+		bool readFloat(float& value_out);
+		bool readBytes(std::size_t size, const unsigned char*& bytes_out);
+		bool seek(std::size_t offset);
+		std::size_t getOffset() const;
+
+	private:
+		const unsigned char* mData;
+		std::size_t mSize;
+		std::size_t mOffset;
+	};
+
+	PackReader::PackReader(const unsigned char* data, std::size_t size)
+		: mData(data), mSize(size), mOffset(0u) {}
+
+	bool PackReader::readVarint(std::uint64_t& value_out)
+	{
+		value_out = 0u;
+		for (unsigned int shift = 0u; shift < 64u && mOffset < mSize; shift += 7u) {
+			unsigned char byte = mData[mOffset++];
+			value_out |= static_cast<std::uint64_t>(byte & 0x7Fu) << shift;
+			if (!(byte & 0x80u))
+				return true;
+		}
+		return false;
+	}
+
+	bool PackReader::readIndex(std::size_t table_size, unsigned int& index_out)
+	{
+		std::uint64_t value;
+		if (!readVarint(value) || value >= table_size)
+			return false;
+		index_out = static_cast<unsigned int>(value);
+		return true;
+	}
+
+	bool PackReader::readCount(std::size_t& count_out)
+	{
+		std::uint64_t value;
+		if (!readVarint(value) || value > mSize - mOffset)
+			return false;
+		count_out = static_cast<std::size_t>(value);
+		return true;
+	}
+
+	bool PackReader::readU32(std::uint32_t& value_out)
+	{
+		const unsigned char* bytes;
+		if (!readBytes(4u, bytes))
+			return false;
+		value_out = static_cast<std::uint32_t>(bytes[0]) | (static_cast<std::uint32_t>(bytes[1]) << 8) | (static_cast<std::uint32_t>(bytes[2]) << 16) | (static_cast<std::uint32_t>(bytes[3]) << 24);
+		return true;
+	}
+
+	bool PackReader::readFloat(float& value_out)
+	{
+		std::uint32_t bits;
+		if (!readU32(bits))
+			return false;
+		value_out = std::bit_cast<float>(bits);
+		return true;
+	}
+
+	bool PackReader::readBytes(std::size_t size, const unsigned char*& bytes_out)
+	{
+		if (size > mSize - mOffset)
+			return false;
+		bytes_out = mData + mOffset;
+		mOffset += size;
+		return true;
+	}
+
+	bool PackReader::seek(std::size_t offset)
+	{
+		if (offset > mSize)
+			return false;
+		mOffset = offset;
+		return true;
+	}
+
+	std::size_t PackReader::getOffset() const
+	{
+		return mOffset;
+	}
+
+	//Everything in front of the group bodies
+	struct PackTables
+	{
+		std::vector<std::string_view> strings; //Into the mapping
+		std::vector<std::string> plugins;
+		std::vector<std::pair<unsigned int, std::size_t>> groups; //Name string index and body offset
+		std::size_t bodiesOffset;
+	};
+
+	bool readPackTables(PackReader& reader, PackTables& tables_out)
+	{
+		const unsigned char* magic;
+		std::uint32_t version;
+		if (!reader.readBytes(sizeof(PACK_MAGIC), magic) || std::memcmp(magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 || !reader.readU32(version)) {
+			spdlog::error("Not an outfit pack");
+			return false;
+		}
+		if (version != PACK_VERSION) {
+			spdlog::error("Unsupported outfit pack version {}", version);
+			return false;
+		}
+
+		std::size_t count;
+		if (!reader.readCount(count))
+			return false;
+		tables_out.strings.reserve(count);
+		for (std::size_t i = 0u; i < count; i++) {
+			std::size_t length;
+			const unsigned char* bytes;
+			if (!reader.readCount(length) || !reader.readBytes(length, bytes))
+				return false;
+			tables_out.strings.push_back(std::string_view(reinterpret_cast<const char*>(bytes), length));
+		}
+
+		if (!reader.readCount(count))
+			return false;
+		tables_out.plugins.reserve(count);
+		for (std::size_t i = 0u; i < count; i++) {
+			unsigned int name_index;
+			if (!reader.readIndex(tables_out.strings.size(), name_index))
+				return false;
+			tables_out.plugins.push_back(std::string(tables_out.strings[name_index]));
+		}
+
+		if (!reader.readCount(count))
+			return false;
+		tables_out.groups.reserve(count);
+		for (std::size_t i = 0u; i < count; i++) {
+			unsigned int name_index;
+			std::uint64_t offset;
+			if (!reader.readIndex(tables_out.strings.size(), name_index) || !reader.readVarint(offset))
+				return false;
+			tables_out.groups.push_back(std::pair<unsigned int, std::size_t>(name_index, static_cast<std::size_t>(offset)));
+		}
+
+		tables_out.bodiesOffset = reader.getOffset();
+		return true;
+	}
+
+	float checkPackedWeight(float weight, const std::string& context)
+	{
+		if (!std::isfinite(weight) || weight < 0.0f) {
+			spdlog::error("Invalid weight for {}", context);
+			return 0.0f;
+		}
+		return weight;
+	}
+
+	//Reads one group body, the reader must be at its offset
+	bool readPackedGroupBody(PackReader& reader, const PackTables& tables, const std::string& group_name, LoadedGroup& loaded_out, bool resolve_forms, FormRejections& rejections)
+	{
+		FormResolver* resolver = getFormResolver();
+		OutfitGroup& group_out = loaded_out.group;
+		std::vector<Outfit>& outfits_out = loaded_out.outfits;
+
+		float weight;
+		std::size_t outfit_count;
+		if (!reader.readFloat(weight) || !reader.readCount(outfit_count))
+			return false;
+
+		group_out.name = SharedName(group_name);
+		group_out.weight = checkPackedWeight(weight, group_name);
+		group_out.loaded = resolve_forms;
+		outfits_out.reserve(outfit_count);
+		NameTable layer_names;
+
+		for (std::size_t i = 0u; i < outfit_count; i++) {
+			unsigned int name_index;
+			std::size_t form_count;
+			if (!reader.readIndex(tables.strings.size(), name_index) || !reader.readFloat(weight) || !reader.readCount(form_count))
+				return false;
+
+			outfits_out.push_back(Outfit());
+			Outfit& outfit = outfits_out.back();
+			outfit.name = std::string(tables.strings[name_index]);
+			outfit.groupName = group_out.name;
+			outfit.id = getOutfitID(outfit.groupName, outfit.name);
+			outfit.weight = checkPackedWeight(weight, outfit.name);
+			if (resolve_forms)
+				outfit.forms.reserve(form_count);
+
+			for (std::size_t k = 0u; k < form_count; k++) {
+				unsigned int plugin_index;
+				std::uint64_t local_form_id;
+				if (!reader.readIndex(tables.plugins.size(), plugin_index) || !reader.readVarint(local_form_id))
+					return false;
+				if (!resolve_forms)
+					continue;
+
+				//Form types are checked for the whole load at once
+				const std::string& mod_name = tables.plugins[plugin_index];
+				GameForm* form = resolver->lookupPluginForm(mod_name, static_cast<FormID>(local_form_id));
+				if (form)
+					outfit.forms.push_back(form);
+				else
+					addFormRejection(rejections, kRejectNotFound, outfit, mod_name + "|" + formIDToString(static_cast<std::uint32_t>(local_form_id)));
+			}
+
+			std::size_t layer_count;
+			if (!reader.readCount(layer_count))
+				return false;
+			for (std::size_t k = 0u; k < layer_count; k++) {
+				unsigned int layer_index;
+				if (!reader.readIndex(tables.strings.size(), layer_index))
+					return false;
+				if (resolve_forms)
+					outfit.layers.push_back(layer_names.intern(std::string(tables.strings[layer_index])));
+			}
+		}
+
+		return true;
+	}
+
+	bool readOutfitPack(const std::string& path, std::vector<LoadedGroup>& groups_out, std::unordered_set<std::string>& group_names, bool resolve_forms, FormRejections& rejections)
+	{
+		OPL_INFO(LogCategory::kGroups, "Reading outfit pack {}", path);
+
+		MappedFile file;
+		if (!file.open(path)) {
+			spdlog::error("Unable to map outfit pack {}", path);
+			return false;
+		}
+
+		PackReader reader(file.getData(), file.getSize());
+		PackTables tables;
+		if (!readPackTables(reader, tables)) {
+			spdlog::error("Invalid outfit pack {}", path);
+			return false;
+		}
+
+		groups_out.reserve(groups_out.size() + tables.groups.size());
+		for (const std::pair<unsigned int, std::size_t>& group_entry : tables.groups) {
+			std::string group_name(tables.strings[group_entry.first]);
+			if (group_names.contains(group_name)) {
+				OPL_INFO(LogCategory::kGroups, "Outfit group {} in outfit pack {} is already loaded", group_name, path);
+				continue;
+			}
+
+			groups_out.push_back(LoadedGroup());
+			LoadedGroup& packed_group = groups_out.back();
+			if (!reader.seek(tables.bodiesOffset + group_entry.second) || !readPackedGroupBody(reader, tables, group_name, packed_group, resolve_forms, rejections)) {
+				spdlog::error("Invalid outfit group {} in outfit pack {}", group_name, path);
+				groups_out.pop_back();
+				continue;
+			}
+			packed_group.group.packFile = path;
+			group_names.insert(group_name);
+		}
+
+		return true;
+	}
+
+	bool readPackedGroup(const std::string& path, const std::string& group_name, LoadedGroup& group_out, FormRejections& rejections)
+	{
+		MappedFile file;
+		if (!file.open(path)) {
+			spdlog::error("Unable to map outfit pack {}", path);
+			return false;
+		}
+
+		PackReader reader(file.getData(), file.getSize());
+		PackTables tables;
+		if (!readPackTables(reader, tables)) {
+			spdlog::error("Invalid outfit pack {}", path);
+			return false;
+		}
+
+		for (const std::pair<unsigned int, std::size_t>& group_entry : tables.groups) {
+			if (tables.strings[group_entry.first] != group_name)
+				continue;
+
+			if (!reader.seek(tables.bodiesOffset + group_entry.second) || !readPackedGroupBody(reader, tables, group_name, group_out, true, rejections)) {
+				spdlog::error("Invalid outfit group {} in outfit pack {}", group_name, path);
+				return false;
+			}
+			group_out.group.packFile = path;
+			return true;
+		}
+
+		spdlog::error("Outfit group {} not found in outfit pack {}", group_name, path);
+		return false;
+	}
+
+	bool readStoredGroupBody(PackReader& reader, const PackTables& tables, PackedGroup& group_out)
+	{
+		float weight;
+		std::size_t outfit_count;
+		if (!reader.readFloat(weight) || !reader.readCount(outfit_count))
+			return false;
+
+		group_out.outfits.resize(outfit_count);
+		for (PackedOutfit& outfit : group_out.outfits) {
+			unsigned int name_index;
+			std::size_t form_count;
+			if (!reader.readIndex(tables.strings.size(), name_index) || !reader.readFloat(weight) || !reader.readCount(form_count))
+				return false;
+			outfit.name = std::string(tables.strings[name_index]);
+
+			outfit.forms.reserve(form_count);
+			for (std::size_t k = 0u; k < form_count; k++) {
+				unsigned int plugin_index;
+				std::uint64_t local_form_id;
+				if (!reader.readIndex(tables.plugins.size(), plugin_index) || !reader.readVarint(local_form_id))
+					return false;
+				outfit.forms.push_back(std::pair<std::string, FormID>(tables.plugins[plugin_index], static_cast<FormID>(local_form_id)));
+			}
+
+			std::size_t layer_count;
+			if (!reader.readCount(layer_count))
+				return false;
+			for (std::size_t k = 0u; k < layer_count; k++) {
+				unsigned int layer_index;
+				if (!reader.readIndex(tables.strings.size(), layer_index))
+					return false;
+				outfit.layers.push_back(std::string(tables.strings[layer_index]));
+			}
+		}
+
+		return true;
+	}
+
+	bool readPackedGroups(const std::string& path, std::vector<PackedGroup>& groups_out)
+	{
+		MappedFile file;
+		if (!file.open(path))
+			return false;
+
+		PackReader reader(file.getData(), file.getSize());
+		PackTables tables;
+		if (!readPackTables(reader, tables))
+			return false;
+
+		groups_out.reserve(tables.groups.size());
+		for (const std::pair<unsigned int, std::size_t>& group_entry : tables.groups) {
+			groups_out.push_back(PackedGroup());
+			groups_out.back().name = std::string(tables.strings[group_entry.first]);
+			if (!reader.seek(tables.bodiesOffset + group_entry.second) || !readStoredGroupBody(reader, tables, groups_out.back())) {
+				groups_out.pop_back();
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	//Export
+
+	void writeVarint(std::string& out, std::uint64_t value)
+	{
+		while (value >= 0x80u) {
+			out.push_back(static_cast<char>((value & 0x7Fu) | 0x80u));
+			value >>= 7;
+		}
+		out.push_back(static_cast<char>(value));
+	}
+
+	void writeU32(std::string& out, std::uint32_t value)
+	{
+		for (unsigned int i = 0u; i < 4u; i++)
+			out.push_back(static_cast<char>((value >> (i * 8u)) & 0xFFu));
+	}
+
+	void writeFloat(std::string& out, float value)
+	{
+		writeU32(out, std::bit_cast<std::uint32_t>(value));
+	}
+
+	//Interns strings and plugin names as they are written
+	struct PackBuilder
+	{
+		std::vector<std::string> strings;
+		std::unordered_map<std::string, unsigned int> stringIndices;
+		std::vector<unsigned int> plugins; //Plugin name string indices
+		std::unordered_map<std::string, unsigned int> pluginIndices;
+		std::vector<std::pair<unsigned int, std::size_t>> groups;
+		std::string bodies;
+		unsigned int outfitCount;
+		PackBuilder();
+	};
+
+	PackBuilder::PackBuilder()
+		: outfitCount(0u) {}
+
+	unsigned int addPackString(PackBuilder& builder, const std::string& str)
+	{
+		std::pair<std::unordered_map<std::string, unsigned int>::iterator, bool> string_it = builder.stringIndices.insert(std::pair<std::string, unsigned int>(str, static_cast<unsigned int>(builder.strings.size())));
+		if (string_it.second)
+			builder.strings.push_back(str);
+		return string_it.first->second;
+	}
+
+	unsigned int addPackPlugin(PackBuilder& builder, const std::string& mod_name)
+	{
+		std::pair<std::unordered_map<std::string, unsigned int>::iterator, bool> plugin_it = builder.pluginIndices.insert(std::pair<std::string, unsigned int>(mod_name, static_cast<unsigned int>(builder.plugins.size())));
+		if (plugin_it.second)
+			builder.plugins.push_back(addPackString(builder, mod_name));
+		return plugin_it.first->second;
+	}
+
+	bool exportGroupFile(PackBuilder& builder, const std::string& path)
+	{
+		FormResolver* resolver = getFormResolver();
+
+		std::ifstream group_file(path);
+		Json::Reader reader;
+		Json::Value group_json;
+		reader.parse(group_file, group_json);
+
+		const Json::Value& outfits_json = group_json["outfits"];
+		if (!outfits_json.isObject()) {
+			spdlog::error("Invalid group file JSON {}", path);
+			return false;
+		}
+
+		std::string group_name = std::filesystem::path(path).filename().replace_extension("").string();
+		const Json::Value& weights_json = group_json["weights"];
+		const Json::Value& layers_json = group_json["layers"];
+
+		builder.groups.push_back(std::pair<unsigned int, std::size_t>(addPackString(builder, group_name), builder.bodies.size()));
+		std::string& out = builder.bodies;
+
+		unsigned int outfit_count = 0u;
+		for (Json::Value::const_iterator it = outfits_json.begin(); it != outfits_json.end(); ++it) {
+			if (it->isArray())
+				outfit_count++;
+		}
+
+		writeFloat(out, readWeight(group_json["weight"], group_name));
+		writeVarint(out, outfit_count);
+
+		std::vector<std::pair<unsigned int, FormID>> forms;
+		for (Json::Value::const_iterator it = outfits_json.begin(); it != outfits_json.end(); ++it) {
+			std::string outfit_name = it.key().asString();
+			if (!it->isArray()) {
+				spdlog::error("Invalid outfit JSON {}", outfit_name);
+				continue;
+			}
+
+			forms.clear();
+			for (unsigned int i = 0u; i < it->size(); i++) {
+				std::string mod_name;
+				FormID local_form_id;
+				if (resolver->parseFormReference((*it)[i], mod_name, local_form_id))
+					forms.push_back(std::pair<unsigned int, FormID>(addPackPlugin(builder, mod_name), local_form_id));
+				else
+					spdlog::error("Invalid outfit formID: {}:{}", outfit_name, (*it)[i].asString());
+			}
+
+			writeVarint(out, addPackString(builder, outfit_name));
+			writeFloat(out, weights_json.isObject() ? readWeight(weights_json[outfit_name], outfit_name) : 1.0f);
+			writeVarint(out, forms.size());
+			for (const std::pair<unsigned int, FormID>& form : forms) {
+				writeVarint(out, form.first);
+				writeVarint(out, form.second);
+			}
+
+			const Json::Value& outfit_layers_json = layers_json.isObject() ? layers_json[outfit_name] : Json::Value::nullSingleton();
+			unsigned int layer_count = 0u;
+			for (unsigned int i = 0u; i < outfit_layers_json.size(); i++) {
+				if (outfit_layers_json[i].isString())
+					layer_count++;
+			}
+
+			writeVarint(out, layer_count);
+			for (unsigned int i = 0u; i < outfit_layers_json.size(); i++) {
+				if (outfit_layers_json[i].isString())
+					writeVarint(out, addPackString(builder, outfit_layers_json[i].asString()));
+			}
+			builder.outfitCount++;
+		}
+
+		return true;
+	}
+
+	int ExportOutfitPack(const std::string& group_dir, const std::string& pack_path)
+	{
+		std::vector<std::string> paths;
+		std::error_code error;
+		for (const auto& entry : std::filesystem::directory_iterator(group_dir, error)) {
+			std::string path = entry.path().string();
+			if (path.ends_with(".json"))
+				paths.push_back(path);
+		}
+		std::sort(paths.begin(), paths.end());
+
+		PackBuilder builder;
+		for (const std::string& path : paths)
+			exportGroupFile(builder, path);
+
+		std::string pack;
+		pack.append(PACK_MAGIC, sizeof(PACK_MAGIC));
+		writeU32(pack, PACK_VERSION);
+
+		writeVarint(pack, builder.strings.size());
+		for (const std::string& str : builder.strings) {
+			writeVarint(pack, str.size());
+			pack.append(str);
+		}
+
+		writeVarint(pack, builder.plugins.size());
+		for (unsigned int name_index : builder.plugins)
+			writeVarint(pack, name_index);
+
+		writeVarint(pack, builder.groups.size());
+		for (const std::pair<unsigned int, std::size_t>& group_entry : builder.groups) {
+			writeVarint(pack, group_entry.first);
+			writeVarint(pack, group_entry.second);
+		}
+
+		pack.append(builder.bodies);
+
+		std::ofstream pack_file(pack_path, std::ios::binary);
+		if (!pack_file || !pack_file.write(pack.data(), pack.size())) {
+			spdlog::error("Unable to write outfit pack {}", pack_path);
+			return -1;
+		}
+
+		OPL_INFO(LogCategory::kGroups, "Exported {} outfits in {} groups to outfit pack {}, {} bytes", builder.outfitCount, builder.groups.size(), pack_path, pack.size());
+		return static_cast<int>(builder.groups.size());
+	}
+}
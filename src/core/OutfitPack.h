@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Catalog.h"
+#include "FormFilter.h"
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace OutfitPlaylist
+{
+	//Outfit packs ship many groups in one file. Strings and plugin names are stored once in tables
+	//and forms as a plugin index and plugin local form id, all integers as LEB128 varints:
+	//  "OPLK", u32 version
+	//  strings: count, per string its length and bytes
+	//  plugins: count, per plugin its name's string index
+	//  groups: count, per group its name's string index and body offset from the first body
+	//  bodies: f32 weight, outfit count, per outfit its name's string index, f32 weight,
+	//    form count, per form its plugin index and local form id, layer count, per layer its string index
+	const char* const OUTFIT_PACK_EXTENSION = ".oplpack";
+
+	//Appends the pack's groups like readGroupFile, packFile is set on each group. Groups already
+	//in group_names are skipped and the ones read are added to it.
+	//Without resolve_forms only names and weights are read and the forms are left empty.
+	bool readOutfitPack(const std::string& path, std::vector<LoadedGroup>& groups_out, std::unordered_set<std::string>& group_names, bool resolve_forms, FormRejections& rejections);
+
+	//Reads one group with its forms, for groups that were only scanned
+	bool readPackedGroup(const std::string& path, const std::string& group_name, LoadedGroup& group_out, FormRejections& rejections);
+
+	//A pack group as stored, nothing is looked up
+	struct PackedOutfit
+	{
+		std::string name;
+		std::vector<std::pair<std::string, FormID>> forms; //Plugin name and plugin local form id
+		std::vector<std::string> layers;
+	};
+
+	struct PackedGroup
+	{
+		std::string name;
+		std::vector<PackedOutfit> outfits;
+	};
+
+	//Every group in the pack as stored, for validation. Returns false if the pack can't be read,
+	//groups_out then holds the groups read before the broken one.
+	bool readPackedGroups(const std::string& path, std::vector<PackedGroup>& groups_out);
+
+	//Converts every group file in group_dir into one pack. References are converted as written,
+	//their plugins don't have to be loaded. Returns the number of groups written, -1 on failure.
+	int ExportOutfitPack(const std::string& group_dir, const std::string& pack_path);
+}
@@ -0,0 +1,176 @@
+#include "PerfStats.h"
+#include "LogCategories.h"
+
+#include <atomic>
+#include <bit>
+
+namespace OutfitPlaylist
+{
+	const char* const PerfStatNames[] = {
+		"LoadPluginData",
+		"ReloadGroupFiles",
+		"GameLoaded",
+		"GameSaved",
+		"SaveGroupFile",
+		"GetNumOutfits",
+		"GetOutfitForms",
+		"GetOutfitName",
+		"GetOutfitGroupName",
+		"GetOutfitIndex",
+		"GetActorOutfitGroupName",
+		"GetActorOutfitName",
+		"ExtSetOutfit",
+		"ExtClearOutfit",
+		"GetShuffledOutfitIndex",
+		"GetOutfitShuffleIndex",
+		"GetNumContextOutfits",
+		"GetContextOutfitIndex",
+		"GetGroupPlaylistSize",
+		"GetGroupShuffledOutfitIndex",
+		"GetGroupOutfitShuffleIndex",
+		"GetNonRepeatingOutfitIndex",
+		"ClearOutfitHistory",
+		"GetOutfitWeight",
+		"GetWeightedOutfitIndex",
+		"RegisterCurrentOutfit",
+		"ReplaceCurrentOutfit",
+		"RenameCurrentOutfit",
+		"GetGroupNames",
+		"GetGroupOutfitNames",
+		"GetOutfitSlotMask",
+		"GetOutfitID",
+		"GetOutfitIndexByID",
+		"ExtSetOutfitByID",
+		"GetActorOutfitInfo",
+		"GetPerfStats",
+		"LogPerfStats",
+		"GetMemoryStats",
+		"CompactCatalog"
+	};
+
+	const char* const PerfCounterNames[] = {
+		"CatalogPublish",
+		"ShuffleCacheHit",
+		"ShuffleCacheMiss",
+		"PlaylistCacheHit",
+		"PlaylistCacheMiss",
+		"OutfitInfoCacheHit",
+		"OutfitInfoCacheMiss"
+	};
+
+	static_assert(sizeof(PerfStatNames) / sizeof(PerfStatNames[0]) == kPerfNumStats);
+	static_assert(sizeof(PerfCounterNames) / sizeof(PerfCounterNames[0]) == kCounterNumCounters);
+
+	//Relaxed atomics only, a summary taken mid-update can be off by the samples in flight
+	struct alignas(64) PerfStatData
+	{
+		std::atomic<std::uint64_t> count;
+		std::atomic<std::uint64_t> totalNanoseconds;
+		std::atomic<std::uint64_t> maxNanoseconds;
+		std::atomic<std::uint64_t> buckets[PERF_HISTOGRAM_BUCKETS];
+	};
+
+	struct alignas(64) PerfCounterData
+	{
+		std::atomic<std::uint64_t> count;
+	};
+
+	PerfStatData sPerfStats[kPerfNumStats];
+	PerfCounterData sPerfCounters[kCounterNumCounters];
+
+	const char* getPerfStatName(PerfStat stat)
+	{
+		return PerfStatNames[stat];
+	}
+
+	void recordPerfSample(PerfStat stat, std::uint64_t nanoseconds)
+	{
+		PerfStatData& data = sPerfStats[stat];
+		data.count.fetch_add(1u, std::memory_order_relaxed);
+		data.totalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+		std::uint64_t max = data.maxNanoseconds.load(std::memory_order_relaxed);
+		while (nanoseconds > max && !data.maxNanoseconds.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed));
+
+		unsigned int bucket = std::min<unsigned int>(static_cast<unsigned int>(std::bit_width(nanoseconds / 1000u)), PERF_HISTOGRAM_BUCKETS - 1u);
+		data.buckets[bucket].fetch_add(1u, std::memory_order_relaxed);
+	}
+
+	void incrementPerfCounter(PerfCounter counter)
+	{
+		sPerfCounters[counter].count.fetch_add(1u, std::memory_order_relaxed);
+	}
+
+	void resetPerfStats()
+	{
+		for (unsigned int i = 0u; i < kPerfNumStats; i++) {
+			sPerfStats[i].count.store(0u, std::memory_order_relaxed);
+			sPerfStats[i].totalNanoseconds.store(0u, std::memory_order_relaxed);
+			sPerfStats[i].maxNanoseconds.store(0u, std::memory_order_relaxed);
+			for (unsigned int k = 0u; k < PERF_HISTOGRAM_BUCKETS; k++)
+				sPerfStats[i].buckets[k].store(0u, std::memory_order_relaxed);
+		}
+
+		for (unsigned int i = 0u; i < kCounterNumCounters; i++)
+			sPerfCounters[i].count.store(0u, std::memory_order_relaxed);
+	}
+
+	//Upper bound in microseconds of the bucket holding the given fraction of samples
+	std::uint64_t getPercentileBound(const std::uint64_t* buckets, std::uint64_t count, double fraction)
+	{
+		std::uint64_t target = static_cast<std::uint64_t>(count * fraction);
+		std::uint64_t seen = 0u;
+		for (unsigned int i = 0u; i < PERF_HISTOGRAM_BUCKETS; i++) {
+			seen += buckets[i];
+			if (seen > target)
+				return 1ull << i;
+		}
+		return 1ull << (PERF_HISTOGRAM_BUCKETS - 1u);
+	}
+
+	void getPerfSummary(std::vector<std::string>& lines_out)
+	{
+		lines_out.clear();
+
+		for (unsigned int i = 0u; i < kPerfNumStats; i++) {
+			const PerfStatData& data = sPerfStats[i];
+			std::uint64_t count = data.count.load(std::memory_order_relaxed);
+			if (count == 0u)
+				continue;
+
+			std::uint64_t buckets[PERF_HISTOGRAM_BUCKETS];
+			for (unsigned int k = 0u; k < PERF_HISTOGRAM_BUCKETS; k++)
+				buckets[k] = data.buckets[k].load(std::memory_order_relaxed);
+
+			double avg_us = data.totalNanoseconds.load(std::memory_order_relaxed) / 1000.0 / count;
+			double max_us = data.maxNanoseconds.load(std::memory_order_relaxed) / 1000.0;
+			lines_out.push_back(fmt::format("{}: {} calls, avg {:.1f}us, p50 <{}us, p99 <{}us, max {:.1f}us",
+				PerfStatNames[i], count, avg_us, getPercentileBound(buckets, count, 0.5), getPercentileBound(buckets, count, 0.99), max_us));
+		}
+
+		for (unsigned int i = 0u; i < kCounterNumCounters; i++) {
+			std::uint64_t count = sPerfCounters[i].count.load(std::memory_order_relaxed);
+			if (count > 0u)
+				lines_out.push_back(fmt::format("{}: {}", PerfCounterNames[i], count));
+		}
+	}
+
+	void logPerfSummary()
+	{
+		std::vector<std::string> lines;
+		getPerfSummary(lines);
+
+		OPL_INFO(LogCategory::kPerf, "Performance summary, {} entries", lines.size());
+		for (const std::string& line : lines)
+			OPL_INFO(LogCategory::kPerf, "{}", line);
+	}
+
+	PerfTimer::PerfTimer(PerfStat stat)
+		: stat(stat), start(std::chrono::steady_clock::now()) {}
+
+	PerfTimer::~PerfTimer()
+	{
+		std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+		recordPerfSample(stat, static_cast<std::uint64_t>(elapsed.count()));
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace OutfitPlaylist
+{
+	//Timed phases and natives, names are in PerfStatNames
+	enum PerfStat
+	{
+		kPerfLoadPluginData = 0,
+		kPerfReloadGroupFiles,
+		kPerfGameLoaded,
+		kPerfGameSaved,
+		kPerfSaveGroupFile,
+		kPerfGetNumOutfits,
+		kPerfGetOutfitForms,
+		kPerfGetOutfitName,
+		kPerfGetOutfitGroupName,
+		kPerfGetOutfitIndex,
+		kPerfGetActorOutfitGroupName,
+		kPerfGetActorOutfitName,
+		kPerfSetOutfit,
+		kPerfClearOutfit,
+		kPerfGetShuffledOutfitIndex,
+		kPerfGetOutfitShuffleIndex,
+		kPerfGetNumContextOutfits,
+		kPerfGetContextOutfitIndex,
+		kPerfGetGroupPlaylistSize,
+		kPerfGetGroupShuffledOutfitIndex,
+		kPerfGetGroupOutfitShuffleIndex,
+		kPerfGetNonRepeatingOutfitIndex,
+		kPerfClearOutfitHistory,
+		kPerfGetOutfitWeight,
+		kPerfGetWeightedOutfitIndex,
+		kPerfRegisterCurrentOutfit,
+		kPerfReplaceCurrentOutfit,
+		kPerfRenameCurrentOutfit,
+		kPerfGetGroupNames,
+		kPerfGetGroupOutfitNames,
+		kPerfGetOutfitSlotMask,
+		kPerfGetOutfitID,
+		kPerfGetOutfitIndexByID,
+		kPerfSetOutfitByID,
+		kPerfGetActorOutfitInfo,
+		kPerfGetPerfStats,
+		kPerfLogPerfStats,
+		kPerfGetMemoryStats,
+		kPerfCompactCatalog,
+		kPerfNumStats
+	};
+
+	//Plain event counters
+	enum PerfCounter
+	{
+		kCounterCatalogPublish = 0,
+		kCounterShuffleCacheHit,
+		kCounterShuffleCacheMiss,
+		kCounterPlaylistCacheHit,
+		kCounterPlaylistCacheMiss,
+		kCounterOutfitInfoCacheHit,
+		kCounterOutfitInfoCacheMiss,
+		kCounterNumCounters
+	};
+
+	//Bucket 0 is under 1us, bucket i is [2^(i-1), 2^i) us, the last bucket is open ended
+	const unsigned int PERF_HISTOGRAM_BUCKETS = 24u;
+
+	const char* getPerfStatName(PerfStat stat);
+
+	void recordPerfSample(PerfStat stat, std::uint64_t nanoseconds);
+	void incrementPerfCounter(PerfCounter counter);
+	void resetPerfStats();
+
+	//One summary line per stat or counter that has been hit since the last reset
+	void getPerfSummary(std::vector<std::string>& lines_out);
+	void logPerfSummary();
+
+	//Records the lifetime of the enclosing scope
+	class PerfTimer
+	{
+	public:
+		explicit PerfTimer(PerfStat stat);
+		~PerfTimer();
+
+	private:
+		PerfStat stat;
+		std::chrono::steady_clock::time_point start;
+	};
+}
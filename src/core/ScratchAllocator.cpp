@@ -0,0 +1,71 @@
+#include "ScratchAllocator.h"
+
+#include <atomic>
+
+namespace OutfitPlaylist
+{
+	const std::size_t SCRATCH_HEADER_BYTES = alignof(std::max_align_t);
+
+	enum ScratchBlockState : unsigned int
+	{
+		kScratchTaken = 1u,
+		kScratchOrphaned = 2u //Its thread is gone, whoever clears the last flag deletes it
+	};
+
+	struct ScratchBlock
+	{
+		alignas(std::max_align_t) unsigned char bytes[SCRATCH_HEADER_BYTES + SCRATCH_BLOCK_BYTES];
+		std::atomic<unsigned int> state;
+		ScratchBlock() : state(0u) {}
+	};
+
+	//Created on the thread's first native, orphaned when the thread exits
+	struct ThreadScratchBlock
+	{
+		ScratchBlock* block;
+
+		ThreadScratchBlock() : block(new ScratchBlock()) {}
+
+		~ThreadScratchBlock()
+		{
+			if (!(block->state.fetch_or(kScratchOrphaned, std::memory_order_acq_rel) & kScratchTaken))
+				delete block;
+		}
+	};
+
+	ScratchBlock* getThreadScratchBlock()
+	{
+		thread_local ThreadScratchBlock thread_block;
+		return thread_block.block;
+	}
+
+	void* allocateScratch(std::size_t bytes)
+	{
+		ScratchBlock* block = NULL;
+		unsigned char* header;
+		if (bytes <= SCRATCH_BLOCK_BYTES) {
+			block = getThreadScratchBlock();
+			if (block->state.fetch_or(kScratchTaken, std::memory_order_acquire) & kScratchTaken)
+				block = NULL; //Still held by an earlier array
+		}
+
+		if (block)
+			header = block->bytes;
+		else
+			header = static_cast<unsigned char*>(::operator new(SCRATCH_HEADER_BYTES + bytes));
+		*reinterpret_cast<ScratchBlock**>(header) = block;
+		return header + SCRATCH_HEADER_BYTES;
+	}
+
+	void deallocateScratch(void* data) noexcept
+	{
+		if (!data)
+			return;
+		unsigned char* header = static_cast<unsigned char*>(data) - SCRATCH_HEADER_BYTES;
+		ScratchBlock* block = *reinterpret_cast<ScratchBlock**>(header);
+		if (!block)
+			::operator delete(header);
+		else if (block->state.fetch_and(~kScratchTaken, std::memory_order_acq_rel) & kScratchOrphaned)
+			delete block;
+	}
+}
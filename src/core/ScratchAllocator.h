@@ -0,0 +1,56 @@
+#pragma once
+
+#include "GameData.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace OutfitPlaylist
+{
+	//One block per thread for the arrays natives return. The VM copies a returned vector into a
+	//Papyrus array and destroys it before that thread runs another native, so the block is free
+	//again for the next call. Requests that don't fit or come while the block is taken use the heap.
+	const std::size_t SCRATCH_BLOCK_BYTES = 4096u;
+
+	//Every allocation is headed by the block it came from, NULL for the heap, so it can be freed
+	//on any thread. A block outlives its thread until its allocation is freed.
+	void* allocateScratch(std::size_t bytes);
+	void deallocateScratch(void* data) noexcept;
+
+	//Stateless, any two allocators can free each other's memory
+	template <class T>
+	class ScratchAllocator
+	{
+	public:
+		typedef T value_type;
+		typedef std::true_type is_always_equal;
+
+		static_assert(alignof(T) <= alignof(std::max_align_t), "ScratchAllocator doesn't support over-aligned types");
+
+		ScratchAllocator() noexcept {}
+
+		template <class U>
+		ScratchAllocator(const ScratchAllocator<U>&) noexcept {}
+
+		T* allocate(std::size_t count)
+		{
+			return static_cast<T*>(allocateScratch(count * sizeof(T)));
+		}
+
+		void deallocate(T* data, std::size_t) noexcept
+		{
+			deallocateScratch(data);
+		}
+
+		template <class U>
+		bool operator==(const ScratchAllocator<U>&) const noexcept
+		{
+			return true;
+		}
+	};
+
+	//What form list natives return
+	typedef std::vector<GameForm*, ScratchAllocator<GameForm*>> NativeFormArray;
+}
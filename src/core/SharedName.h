@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <fmt/format.h>
+
+namespace OutfitPlaylist
+{
+	//Immutable string shared by every copy, for names repeated across outfits and actors.
+	//Copies cost a reference count, only constructing from a string allocates.
+	class SharedName
+	{
+	public:
+		SharedName() {}
+		explicit SharedName(const std::string& value) : mValue(std::make_shared<const std::string>(value)) {}
+
+		const std::string& str() const
+		{
+			static const std::string empty;
+			return mValue ? *mValue : empty;
+		}
+
+		operator const std::string&() const { return str(); }
+		bool empty() const { return str().empty(); }
+		std::size_t size() const { return str().size(); }
+		void clear() { mValue.reset(); }
+
+		//Identifies the shared string, for counting it once in memory usage
+		const void* getKey() const { return mValue.get(); }
+
+		bool operator==(const SharedName& other) const { return mValue == other.mValue || str() == other.str(); }
+		bool operator==(const std::string& other) const { return str() == other; }
+
+	private:
+		std::shared_ptr<const std::string> mValue;
+	};
+
+	//One SharedName per distinct string, interns the names of a single load
+	class NameTable
+	{
+	public:
+		const SharedName& intern(const std::string& value)
+		{
+			std::unordered_map<std::string, SharedName>::iterator it = mNames.find(value);
+			if (it == mNames.end())
+				it = mNames.insert(std::pair<std::string, SharedName>(value, SharedName(value))).first;
+			return it->second;
+		}
+
+	private:
+		std::unordered_map<std::string, SharedName> mNames;
+	};
+}
+
+template <>
+struct fmt::formatter<OutfitPlaylist::SharedName> : fmt::formatter<std::string_view>
+{
+	template <class FormatContext>
+	auto format(const OutfitPlaylist::SharedName& name, FormatContext& context) const
+	{
+		return fmt::formatter<std::string_view>::format(std::string_view(name.str()), context);
+	}
+};
@@ -0,0 +1,347 @@
+#include "Validation.h"
+#include "CoreUtil.h"
+#include "GameData.h"
+#include "LogCategories.h"
+#include "OutfitPack.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace OutfitPlaylist
+{
+	const char* const ValidationIssueNames[] = {
+		"invalidFile",
+		"invalidOutfit",
+		"invalidForm",
+		"missingPlugin",
+		"unresolvedForm",
+		"wrongFormType",
+		"duplicateOutfit",
+		"nameCollision",
+		"missingLayer"
+	};
+
+	static_assert(sizeof(ValidationIssueNames) / sizeof(ValidationIssueNames[0]) == kIssueNumIssues);
+
+	struct ValidatedOutfit
+	{
+		std::string name;
+		std::vector<std::string> layers;
+		std::uint64_t fingerprint; //0 for layered outfits and outfits without resolved forms
+	};
+
+	//Everything one worker found in one group file
+	struct GroupValidation
+	{
+		std::string name;
+		std::vector<ValidatedOutfit> outfits;
+		unsigned int formCount;
+		unsigned int issueCounts[kIssueNumIssues];
+		Json::Value issues;
+		std::map<std::string, unsigned int> missingPlugins;
+		GroupValidation();
+	};
+
+	GroupValidation::GroupValidation()
+		: formCount(0u), issueCounts(), issues(Json::arrayValue) {}
+
+	const char* getValidationIssueName(ValidationIssue issue)
+	{
+		return issue < kIssueNumIssues ? ValidationIssueNames[issue] : "unknown";
+	}
+
+	void addValidationIssue(GroupValidation& result, ValidationIssue issue, const std::string& outfit_name, const std::string& detail)
+	{
+		Json::Value issue_json;
+		issue_json["type"] = getValidationIssueName(issue);
+		issue_json["group"] = result.name;
+		if (!outfit_name.empty())
+			issue_json["outfit"] = outfit_name;
+		issue_json["detail"] = detail;
+		result.issues.append(issue_json);
+		result.issueCounts[issue]++;
+	}
+
+	//Order independent hash of the outfit's forms
+	std::uint64_t getFormFingerprint(std::vector<FormID>& form_ids)
+	{
+		std::sort(form_ids.begin(), form_ids.end());
+		std::uint64_t hash = hashBytes(form_ids.data(), form_ids.size() * sizeof(FormID));
+		return hash == 0u ? 1u : hash;
+	}
+
+	void checkOutfitName(GroupValidation& result, std::unordered_map<std::string, std::string>& lowercase_names, const std::string& outfit_name)
+	{
+		std::pair<std::unordered_map<std::string, std::string>::iterator, bool> name_it = lowercase_names.insert(std::pair<std::string, std::string>(toLowercase(outfit_name), outfit_name));
+		if (!name_it.second)
+			addValidationIssue(result, kIssueNameCollision, outfit_name, "Same name as " + name_it.first->second);
+	}
+
+	//A reference that parsed, form is NULL if it isn't loaded and mod_name is empty if it wasn't split
+	void checkOutfitForm(GroupValidation& result, const std::string& outfit_name, const std::string& reference, GameForm* form, const std::string& mod_name, std::vector<FormID>& form_ids)
+	{
+		FormResolver* resolver = getFormResolver();
+		if (form) {
+			if (resolver->isOutfitForm(form))
+				form_ids.push_back(resolver->getFormID(form));
+			else
+				addValidationIssue(result, kIssueWrongFormType, outfit_name, reference);
+		}
+		else if (!mod_name.empty() && !resolver->isPluginLoaded(mod_name)) {
+			addValidationIssue(result, kIssueMissingPlugin, outfit_name, reference);
+			result.missingPlugins[mod_name]++;
+		}
+		else
+			addValidationIssue(result, kIssueUnresolvedForm, outfit_name, reference);
+	}
+
+	void validateGroupFile(const std::string& path, GroupValidation& result)
+	{
+		FormResolver* resolver = getFormResolver();
+		result.name = std::filesystem::path(path).filename().replace_extension("").string();
+
+		std::ifstream group_file(path);
+		Json::Reader reader;
+		Json::Value group_json;
+		if (!reader.parse(group_file, group_json)) {
+			addValidationIssue(result, kIssueInvalidFile, std::string(), reader.getFormattedErrorMessages());
+			return;
+		}
+
+		const Json::Value& outfits_json = group_json["outfits"];
+		if (!outfits_json.isObject()) {
+			addValidationIssue(result, kIssueInvalidFile, std::string(), "Missing \"outfits\" object");
+			return;
+		}
+
+		const Json::Value& layers_json = group_json["layers"];
+		std::unordered_map<std::string, std::string> lowercase_names;
+		std::vector<FormID> form_ids;
+		Json::FastWriter writer; //Non-string references in issue details
+		writer.omitEndingLineFeed();
+
+		for (Json::Value::const_iterator it = outfits_json.begin(); it != outfits_json.end(); ++it) {
+			std::string outfit_name = it.key().asString();
+			if (!it->isArray()) {
+				addValidationIssue(result, kIssueInvalidOutfit, outfit_name, "Outfit isn't a form list");
+				continue;
+			}
+
+			checkOutfitName(result, lowercase_names, outfit_name);
+
+			form_ids.clear();
+			for (unsigned int i = 0u; i < it->size(); i++) {
+				const Json::Value& reference_json = (*it)[i];
+				std::string reference = reference_json.isString() ? reference_json.asString() : writer.write(reference_json);
+				result.formCount++;
+
+				GameForm* form = NULL;
+				std::string mod_name;
+				FormID local_form_id;
+				if (!resolver->deserializeForm(reference_json, form)) {
+					addValidationIssue(result, kIssueInvalidForm, outfit_name, reference);
+					continue;
+				}
+				if (!form && !resolver->parseFormReference(reference_json, mod_name, local_form_id))
+					mod_name.clear();
+				checkOutfitForm(result, outfit_name, reference, form, mod_name, form_ids);
+			}
+
+			result.outfits.push_back(ValidatedOutfit());
+			ValidatedOutfit& outfit = result.outfits.back();
+			outfit.name = outfit_name;
+
+			const Json::Value& outfit_layers_json = layers_json.isObject() ? layers_json[outfit_name] : Json::Value::nullSingleton();
+			for (unsigned int i = 0u; i < outfit_layers_json.size(); i++) {
+				if (outfit_layers_json[i].isString())
+					outfit.layers.push_back(outfit_layers_json[i].asString());
+				else
+					addValidationIssue(result, kIssueInvalidOutfit, outfit_name, "Layer isn't an outfit name");
+			}
+
+			outfit.fingerprint = outfit.layers.empty() && !form_ids.empty() ? getFormFingerprint(form_ids) : 0u;
+		}
+	}
+
+	//Packs store references already split, so only lookups can fail
+	void validatePackedGroup(PackedGroup& group, GroupValidation& result)
+	{
+		FormResolver* resolver = getFormResolver();
+		result.name = group.name;
+
+		std::unordered_map<std::string, std::string> lowercase_names;
+		std::vector<FormID> form_ids;
+		for (PackedOutfit& packed_outfit : group.outfits) {
+			checkOutfitName(result, lowercase_names, packed_outfit.name);
+
+			form_ids.clear();
+			for (const std::pair<std::string, FormID>& reference : packed_outfit.forms) {
+				result.formCount++;
+				GameForm* form = resolver->lookupPluginForm(reference.first, reference.second);
+				checkOutfitForm(result, packed_outfit.name, reference.first + "|" + formIDToString(reference.second), form, reference.first, form_ids);
+			}
+
+			result.outfits.push_back(ValidatedOutfit());
+			ValidatedOutfit& outfit = result.outfits.back();
+			outfit.name = packed_outfit.name;
+			outfit.layers.swap(packed_outfit.layers);
+			outfit.fingerprint = outfit.layers.empty() && !form_ids.empty() ? getFormFingerprint(form_ids) : 0u;
+		}
+	}
+
+	//Each group in the pack is checked like a group file, a pack that can't be read is one more invalid file
+	void validateOutfitPack(const std::string& path, std::vector<GroupValidation>& results_out)
+	{
+		std::vector<PackedGroup> groups;
+		bool read = readPackedGroups(path, groups);
+
+		results_out.resize(groups.size());
+		for (std::size_t i = 0u; i < groups.size(); i++)
+			validatePackedGroup(groups[i], results_out[i]);
+
+		if (!read) {
+			results_out.push_back(GroupValidation());
+			results_out.back().name = std::filesystem::path(path).filename().string();
+			addValidationIssue(results_out.back(), kIssueInvalidFile, std::string(), "Invalid outfit pack");
+		}
+	}
+
+	//Checks that need every group: duplicates, group name collisions and layer references
+	void validateAcrossGroups(std::vector<GroupValidation>& results)
+	{
+		std::unordered_map<std::string, std::string> lowercase_groups;
+		std::unordered_set<std::string> outfit_keys; //Lowercase "group/outfit"
+		for (GroupValidation& result : results) {
+			std::pair<std::unordered_map<std::string, std::string>::iterator, bool> group_it = lowercase_groups.insert(std::pair<std::string, std::string>(toLowercase(result.name), result.name));
+			if (!group_it.second)
+				addValidationIssue(result, kIssueNameCollision, std::string(), "Same group name as " + group_it.first->second);
+
+			for (const ValidatedOutfit& outfit : result.outfits)
+				outfit_keys.insert(toLowercase(result.name + "/" + outfit.name));
+		}
+
+		std::unordered_map<std::uint64_t, std::string> fingerprints;
+		for (GroupValidation& result : results) {
+			for (const ValidatedOutfit& outfit : result.outfits) {
+				if (outfit.fingerprint != 0u) {
+					std::pair<std::unordered_map<std::uint64_t, std::string>::iterator, bool> fingerprint_it = fingerprints.insert(std::pair<std::uint64_t, std::string>(outfit.fingerprint, result.name + "/" + outfit.name));
+					if (!fingerprint_it.second)
+						addValidationIssue(result, kIssueDuplicateOutfit, outfit.name, "Same forms as " + fingerprint_it.first->second);
+				}
+
+				for (const std::string& layer : outfit.layers) {
+					std::string key = layer.find('/') == std::string::npos ? result.name + "/" + layer : layer;
+					if (!outfit_keys.contains(toLowercase(key)))
+						addValidationIssue(result, kIssueMissingLayer, outfit.name, layer);
+				}
+			}
+		}
+	}
+
+	unsigned int ValidateGroupFiles(const std::string& group_dir, Json::Value& report_out)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		std::vector<std::string> paths;
+		std::error_code error;
+		for (const auto& entry : std::filesystem::directory_iterator(group_dir, error)) {
+			std::string path = entry.path().string();
+			if (path.ends_with(".json") || path.ends_with(OUTFIT_PACK_EXTENSION))
+				paths.push_back(path);
+		}
+		std::sort(paths.begin(), paths.end());
+
+		//Workers take the next file until none are left, a pack gives a result per group
+		std::vector<std::vector<GroupValidation>> file_results(paths.size());
+		std::atomic<std::size_t> next_path(0u);
+		unsigned int thread_count = std::min<unsigned int>(std::max(std::thread::hardware_concurrency(), 1u), static_cast<unsigned int>(paths.size()));
+		{
+			std::vector<std::jthread> threads;
+			for (unsigned int i = 0u; i < thread_count; i++) {
+				threads.emplace_back([&]() {
+					for (std::size_t index = next_path++; index < paths.size(); index = next_path++) {
+						if (paths[index].ends_with(OUTFIT_PACK_EXTENSION))
+							validateOutfitPack(paths[index], file_results[index]);
+						else {
+							file_results[index].resize(1u);
+							validateGroupFile(paths[index], file_results[index][0]);
+						}
+					}
+				});
+			}
+		}
+
+		std::vector<GroupValidation> results;
+		for (std::vector<GroupValidation>& path_results : file_results) {
+			for (GroupValidation& result : path_results)
+				results.push_back(std::move(result));
+		}
+
+		validateAcrossGroups(results);
+
+		//Report
+		unsigned int issue_counts[kIssueNumIssues] = {};
+		unsigned int outfit_count = 0u;
+		unsigned int form_count = 0u;
+		std::map<std::string, unsigned int> missing_plugins;
+
+		report_out = Json::Value(Json::objectValue);
+		Json::Value& issues_json = report_out["issues"];
+		issues_json = Json::Value(Json::arrayValue);
+		for (GroupValidation& result : results) {
+			outfit_count += static_cast<unsigned int>(result.outfits.size());
+			form_count += result.formCount;
+			for (unsigned int i = 0u; i < kIssueNumIssues; i++)
+				issue_counts[i] += result.issueCounts[i];
+			for (std::map<std::string, unsigned int>::const_iterator it = result.missingPlugins.begin(); it != result.missingPlugins.end(); ++it)
+				missing_plugins[it->first] += it->second;
+			for (Json::Value& issue_json : result.issues)
+				issues_json.append(std::move(issue_json));
+		}
+
+		unsigned int total_issues = 0u;
+		Json::Value& counts_json = report_out["issueCounts"];
+		for (unsigned int i = 0u; i < kIssueNumIssues; i++) {
+			counts_json[ValidationIssueNames[i]] = issue_counts[i];
+			total_issues += issue_counts[i];
+		}
+
+		Json::Value& plugins_json = report_out["missingPlugins"];
+		plugins_json = Json::Value(Json::objectValue);
+		for (std::map<std::string, unsigned int>::const_iterator it = missing_plugins.begin(); it != missing_plugins.end(); ++it)
+			plugins_json[it->first] = it->second;
+
+		report_out["groupDir"] = group_dir;
+		report_out["groupFiles"] = static_cast<unsigned int>(paths.size());
+		report_out["groups"] = static_cast<unsigned int>(results.size());
+		report_out["outfits"] = outfit_count;
+		report_out["forms"] = form_count;
+		report_out["totalIssues"] = total_issues;
+		report_out["threads"] = thread_count;
+		report_out["durationMs"] = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1.0e3;
+
+		OPL_INFO(LogCategory::kGroups, "Validated {} group files and packs with {} groups, {} outfits, {} issues", paths.size(), results.size(), outfit_count, total_issues);
+		return total_issues;
+	}
+
+	bool writeValidationReport(const std::string& path, const Json::Value& report)
+	{
+		std::ofstream report_file(path);
+		if (!report_file) {
+			spdlog::error("Unable to write validation report {}", path);
+			return false;
+		}
+
+		Json::StyledStreamWriter writer;
+		writer.write(report_file, report);
+		return true;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+#include <json/json.h>
+
+namespace OutfitPlaylist
+{
+	//Problems reported by the validation pass, names are in ValidationIssueNames
+	enum ValidationIssue
+	{
+		kIssueInvalidFile = 0,
+		kIssueInvalidOutfit,
+		kIssueInvalidForm,
+		kIssueMissingPlugin,
+		kIssueUnresolvedForm,
+		kIssueWrongFormType,
+		kIssueDuplicateOutfit,
+		kIssueNameCollision,
+		kIssueMissingLayer,
+		kIssueNumIssues
+	};
+
+	const char* getValidationIssueName(ValidationIssue issue);
+
+	//Checks every group file and outfit pack in group_dir on worker threads, without touching the catalog.
+	//The form resolver must be safe to read from several threads. Returns the number of issues.
+	unsigned int ValidateGroupFiles(const std::string& group_dir, Json::Value& report_out);
+	bool writeValidationReport(const std::string& path, const Json::Value& report);
+}
@@ -0,0 +1,227 @@
+#include "FakeGameData.h"
+#include "core/CoreUtil.h"
+
+namespace OutfitPlaylist
+{
+	//FakeFormResolver
+
+	FakeForm* FakeFormResolver::addForm(const std::string& mod_name, FormID local_form_id, bool outfit_form, std::uint32_t slot_mask)
+	{
+		//Mods get load order indices in the order they are first seen
+		std::map<std::string, unsigned int>::iterator mod_it = mModIndices.find(mod_name);
+		if (mod_it == mModIndices.end())
+			mod_it = mModIndices.insert(std::pair<std::string, unsigned int>(mod_name, static_cast<unsigned int>(mModIndices.size()))).first;
+
+		FakeForm form;
+		form.formID = (mod_it->second << 24) | (local_form_id & 0xFFFFFFu);
+		form.modName = mod_name;
+		form.localFormID = local_form_id & 0xFFFFFFu;
+		form.formType = outfit_form ? kFakeFormArmor : kFakeFormMisc;
+		form.slotMask = slot_mask;
+
+		std::map<FormID, FakeForm*>::iterator it = mFormsByID.find(form.formID);
+		if (it != mFormsByID.end()) {
+			*it->second = form;
+			return it->second;
+		}
+
+		mForms.push_back(form);
+		mFormsByID[form.formID] = &mForms.back();
+		return &mForms.back();
+	}
+
+	void FakeFormResolver::addActor(FormID actor_id)
+	{
+		mActors.insert(actor_id);
+	}
+
+	void FakeFormResolver::removeActor(FormID actor_id)
+	{
+		mActors.erase(actor_id);
+		mDeletedActors.erase(actor_id);
+	}
+
+	void FakeFormResolver::deleteActor(FormID actor_id)
+	{
+		if (mActors.contains(actor_id))
+			mDeletedActors.insert(actor_id);
+	}
+
+	std::string FakeFormResolver::formReference(const std::string& mod_name, FormID local_form_id)
+	{
+		return mod_name + "|" + formIDToString(local_form_id);
+	}
+
+	bool FakeFormResolver::deserializeForm(const Json::Value& json, GameForm*& form_out) const
+	{
+		form_out = NULL;
+
+		std::string mod_name;
+		FormID local_form_id;
+		if (!parseFormReference(json, mod_name, local_form_id))
+			return false;
+
+		form_out = lookupPluginForm(mod_name, local_form_id);
+		return true;
+	}
+
+	bool FakeFormResolver::parseFormReference(const Json::Value& json, std::string& mod_name_out, FormID& local_form_id_out) const
+	{
+		if (!json.isString())
+			return false;
+
+		std::string reference = json.asString();
+		std::size_t separator = reference.rfind('|');
+		if (separator == std::string::npos || separator + 1u >= reference.size())
+			return false;
+
+		mod_name_out = reference.substr(0u, separator);
+		local_form_id_out = stringToFormID(reference.substr(separator + 1u)) & 0xFFFFFFu;
+		return true;
+	}
+
+	bool FakeFormResolver::isPluginLoaded(const std::string& mod_name) const
+	{
+		return mModIndices.contains(mod_name);
+	}
+
+	GameForm* FakeFormResolver::lookupPluginForm(const std::string& mod_name, FormID local_form_id) const
+	{
+		std::map<std::string, unsigned int>::const_iterator mod_it = mModIndices.find(mod_name);
+		if (mod_it == mModIndices.end())
+			return NULL;
+		return lookupForm((mod_it->second << 24) | (local_form_id & 0xFFFFFFu));
+	}
+
+	void FakeFormResolver::serializeForm(const GameForm* form, Json::Value& json_out) const
+	{
+		json_out = formReference(form->modName, form->localFormID);
+	}
+
+	GameForm* FakeFormResolver::lookupForm(FormID form_id) const
+	{
+		std::map<FormID, FakeForm*>::const_iterator it = mFormsByID.find(form_id);
+		return it != mFormsByID.end() ? it->second : NULL;
+	}
+
+	FormID FakeFormResolver::getFormID(const GameForm* form) const
+	{
+		return form->formID;
+	}
+
+	bool FakeFormResolver::actorExists(FormID actor_id) const
+	{
+		return mActors.contains(actor_id);
+	}
+
+	ActorStatus FakeFormResolver::getActorStatus(FormID actor_id) const
+	{
+		if (!mActors.contains(actor_id))
+			return kActorMissing;
+		return mDeletedActors.contains(actor_id) ? kActorDeleted : kActorPresent;
+	}
+
+	std::uint8_t FakeFormResolver::getFormType(const GameForm* form) const
+	{
+		return form->formType;
+	}
+
+	bool FakeFormResolver::isOutfitFormType(std::uint8_t form_type) const
+	{
+		return form_type == kFakeFormArmor;
+	}
+
+	std::uint32_t FakeFormResolver::getSlotMask(const GameForm* form) const
+	{
+		return form->slotMask;
+	}
+
+	//FakeRecordSerializer
+
+	FakeRecordSerializer::FakeRecordSerializer()
+		: mReadIndex(0u) {}
+
+	void FakeRecordSerializer::rewind()
+	{
+		mReadIndex = 0u;
+	}
+
+	void FakeRecordSerializer::clear()
+	{
+		mRecords.clear();
+		mReadIndex = 0u;
+	}
+
+	std::size_t FakeRecordSerializer::getSize() const
+	{
+		std::size_t size = 0u;
+		for (const Record& record : mRecords)
+			size += record.data.size();
+		return size;
+	}
+
+	bool FakeRecordSerializer::getNextRecordInfo(std::uint32_t& type, std::uint32_t& version, std::uint32_t& length)
+	{
+		if (mReadIndex >= mRecords.size())
+			return false;
+
+		const Record& record = mRecords[mReadIndex++];
+		type = record.type;
+		version = record.version;
+		length = static_cast<std::uint32_t>(record.data.size());
+		return true;
+	}
+
+	bool FakeRecordSerializer::readRecordJson(Json::Value& json_out)
+	{
+		if (mReadIndex == 0u)
+			return false;
+
+		Json::Reader reader;
+		return reader.parse(mRecords[mReadIndex - 1u].data, json_out);
+	}
+
+	bool FakeRecordSerializer::readRecordData(std::string& data_out, std::uint32_t length)
+	{
+		if (mReadIndex == 0u || length > mRecords[mReadIndex - 1u].data.size())
+			return false;
+
+		data_out.assign(mRecords[mReadIndex - 1u].data, 0u, length);
+		return true;
+	}
+
+	bool FakeRecordSerializer::openRecord(std::uint32_t type, std::uint32_t version)
+	{
+		Record record;
+		record.type = type;
+		record.version = version;
+		mRecords.push_back(record);
+		return true;
+	}
+
+	bool FakeRecordSerializer::writeRecordJson(const Json::Value& json)
+	{
+		if (mRecords.empty())
+			return false;
+
+		Json::FastWriter writer;
+		mRecords.back().data.append(writer.write(json));
+		return true;
+	}
+
+	bool FakeRecordSerializer::writeRecordData(const std::string& data)
+	{
+		if (mRecords.empty())
+			return false;
+
+		mRecords.back().data.append(data);
+		return true;
+	}
+
+	bool FakeRecordSerializer::resolveFormID(FormID old_form_id, FormID& form_id_out)
+	{
+		//Load order never changes between a fake save and load
+		form_id_out = old_form_id;
+		return true;
+	}
+}
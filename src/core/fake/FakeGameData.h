@@ -0,0 +1,89 @@
+#pragma once
+
+#include "core/GameData.h"
+
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace OutfitPlaylist
+{
+	//In-memory stand-ins for the game, used by headless builds
+	enum FakeFormType : std::uint8_t
+	{
+		kFakeFormMisc = 0,
+		kFakeFormArmor
+	};
+
+	struct FakeForm
+	{
+		FormID formID;
+		std::string modName;
+		FormID localFormID;
+		std::uint8_t formType;
+		std::uint32_t slotMask;
+	};
+
+	//Forms are referenced as "Mod.esp|0x800" in group and config files
+	class FakeFormResolver : public FormResolver
+	{
+	public:
+		FakeForm* addForm(const std::string& mod_name, FormID local_form_id, bool outfit_form = true, std::uint32_t slot_mask = 0u);
+		void addActor(FormID actor_id);
+		void removeActor(FormID actor_id);
+		void deleteActor(FormID actor_id); //Still resolves, but as a deleted reference
+
+		static std::string formReference(const std::string& mod_name, FormID local_form_id);
+
+		virtual bool deserializeForm(const Json::Value& json, GameForm*& form_out) const override;
+		virtual void serializeForm(const GameForm* form, Json::Value& json_out) const override;
+		virtual bool parseFormReference(const Json::Value& json, std::string& mod_name_out, FormID& local_form_id_out) const override;
+		virtual bool isPluginLoaded(const std::string& mod_name) const override;
+		virtual GameForm* lookupPluginForm(const std::string& mod_name, FormID local_form_id) const override;
+		virtual GameForm* lookupForm(FormID form_id) const override;
+		virtual FormID getFormID(const GameForm* form) const override;
+		virtual bool actorExists(FormID actor_id) const override;
+		virtual ActorStatus getActorStatus(FormID actor_id) const override;
+		virtual std::uint8_t getFormType(const GameForm* form) const override;
+		virtual bool isOutfitFormType(std::uint8_t form_type) const override;
+		virtual std::uint32_t getSlotMask(const GameForm* form) const override;
+
+	private:
+		std::deque<FakeForm> mForms; //Stable addresses
+		std::map<FormID, FakeForm*> mFormsByID;
+		std::map<std::string, unsigned int> mModIndices;
+		std::set<FormID> mActors;
+		std::set<FormID> mDeletedActors;
+	};
+
+	//Cosave records kept in memory, rewind to read back what was written
+	class FakeRecordSerializer : public RecordSerializer
+	{
+	public:
+		FakeRecordSerializer();
+
+		void rewind();
+		void clear();
+		std::size_t getSize() const;
+
+		virtual bool getNextRecordInfo(std::uint32_t& type, std::uint32_t& version, std::uint32_t& length) override;
+		virtual bool readRecordJson(Json::Value& json_out) override;
+		virtual bool readRecordData(std::string& data_out, std::uint32_t length) override;
+		virtual bool openRecord(std::uint32_t type, std::uint32_t version) override;
+		virtual bool writeRecordJson(const Json::Value& json) override;
+		virtual bool writeRecordData(const std::string& data) override;
+		virtual bool resolveFormID(FormID old_form_id, FormID& form_id_out) override;
+
+	private:
+		struct Record
+		{
+			std::uint32_t type;
+			std::uint32_t version;
+			std::string data;
+		};
+
+		std::vector<Record> mRecords;
+		std::size_t mReadIndex;
+	};
+}
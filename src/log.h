@@ -1,15 +1,17 @@
 #pragma once
 
-#include <spdlog/sinks/basic_file_sink.h>
+#include "core/LogCategories.h"
 
 void SetupLog() {
     auto logsFolder = SKSE::log::log_directory();
     if (!logsFolder) SKSE::stl::report_and_fail("SKSE log_directory not provided, logs disabled.");
     auto pluginName = SKSE::PluginDeclaration::GetSingleton()->GetName();
     auto logFilePath = *logsFolder / std::format("{}.log", pluginName);
-    auto fileLoggerPtr = std::make_shared<spdlog::sinks::basic_file_sink_mt>(logFilePath.string(), true);
-    auto loggerPtr = std::make_shared<spdlog::logger>("log", std::move(fileLoggerPtr));
-    spdlog::set_default_logger(std::move(loggerPtr));
-    spdlog::set_level(spdlog::level::trace);
-    spdlog::flush_on(spdlog::level::trace);
+
+    Json::Reader reader;
+    std::ifstream config_file("Data/SKSE/Plugins/OutfitPlaylistConfig.json");
+    Json::Value config_json;
+    reader.parse(config_file, config_json);
+
+    setupLogCategories(logFilePath, config_json["logging"]);
 }
@@ -0,0 +1,94 @@
+#include "core/ActorState.h"
+#include "core/Catalog.h"
+#include "core/fake/FakeGameData.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+//Saves actor state with actors going missing and coming back between saves, and checks that
+//loading each record gives back every equipped outfit. Exits with 1 on failure.
+//Usage: OutfitPlaylistActorSaveTest
+
+using namespace OutfitPlaylist;
+
+const std::string TestModName = "Test.esp";
+const FormID TestFirstLocalFormID = 0x800u;
+const FormID SteadyActorID = 0xFF000800u; //Resolves at every save
+const FormID FlickerActorID = 0xFF000801u; //Missing at the save after it was equipped
+
+void writeGroupFile(const std::string& dir, const std::string& group_name, const std::vector<std::string>& outfit_names)
+{
+	Json::Value group_json;
+	for (unsigned int i = 0u; i < outfit_names.size(); i++)
+		group_json["outfits"][outfit_names[i]].append(FakeFormResolver::formReference(TestModName, TestFirstLocalFormID + i));
+
+	std::ofstream group_file(dir + "/" + group_name + ".json");
+	Json::FastWriter writer;
+	group_file << writer.write(group_json);
+}
+
+bool check(bool condition, const char* message)
+{
+	if (!condition)
+		std::cerr << "Failed: " << message << std::endl;
+	return condition;
+}
+
+//Loads the record into a fresh actor state, like loading the save in game
+bool hasSavedOutfit(FakeRecordSerializer& serde, FormID actor_id, const std::string& outfit_name)
+{
+	clearActorState();
+	serde.rewind();
+	loadActorState(serde);
+
+	Outfit outfit;
+	return getActorOutfit(actor_id, outfit) && outfit.name == outfit_name;
+}
+
+int main()
+{
+	spdlog::set_default_logger(spdlog::stderr_color_mt("test"));
+	spdlog::set_level(spdlog::level::critical); //Loading the first record reports the missing actor
+
+	FakeFormResolver resolver;
+	SetFormResolver(&resolver);
+	resolver.addForm(TestModName, TestFirstLocalFormID);
+	resolver.addForm(TestModName, TestFirstLocalFormID + 1u);
+	resolver.addActor(SteadyActorID);
+	resolver.addActor(FlickerActorID);
+
+	std::string dir = (std::filesystem::temp_directory_path() / "OutfitPlaylistActorSaveTest").string();
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+	writeGroupFile(dir, "Casual", { "Red", "Blue" });
+	LoadCatalog(dir, Json::Value());
+
+	bool passed = true;
+	int red_index = getOutfitIndex(*getCatalog(), "Casual", "Red");
+	int blue_index = getOutfitIndex(*getCatalog(), "Casual", "Blue");
+	passed &= check(red_index >= 0 && blue_index >= 0, "test outfits not loaded");
+	setActorOutfit(SteadyActorID, static_cast<unsigned int>(red_index), false);
+	setActorOutfit(FlickerActorID, static_cast<unsigned int>(blue_index), false);
+
+	//The flickering actor's outfit can't be written while it doesn't resolve
+	FakeRecordSerializer missing_save;
+	resolver.removeActor(FlickerActorID);
+	saveActorState(missing_save);
+
+	//Back in the next save, which reuses the steady actor's cached entry
+	FakeRecordSerializer present_save;
+	resolver.addActor(FlickerActorID);
+	saveActorState(present_save);
+
+	passed &= check(hasSavedOutfit(present_save, FlickerActorID, "Blue"), "outfit of an actor missing at the previous save was dropped");
+	passed &= check(hasSavedOutfit(present_save, SteadyActorID, "Red"), "cached outfit entry was dropped");
+	passed &= check(hasSavedOutfit(missing_save, SteadyActorID, "Red"), "outfit of a present actor was dropped");
+
+	std::filesystem::remove_all(dir);
+	std::cerr << (passed ? "Passed" : "Failed") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+#include "core/Catalog.h"
+#include "core/fake/FakeGameData.h"
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+//Chi-square check of weighted draws against the weights in the group files, for the group
+//tables and the catalog table. Exits with 1 if a distribution is off.
+//Usage: OutfitPlaylistAliasTest [draws]
+
+using namespace OutfitPlaylist;
+
+const unsigned int DefaultDraws = 400000u;
+const unsigned int DrawSeed = 7u;
+const double CriticalZ = 3.09; //p = 0.001, one sided
+const std::string TestModName = "Test.esp";
+const FormID TestFirstLocalFormID = 0x800u;
+
+struct TestGroup
+{
+	std::string name;
+	float weight;
+	std::vector<float> outfitWeights;
+};
+
+std::string getTestOutfitName(unsigned int outfit)
+{
+	return "Outfit" + std::to_string(outfit);
+}
+
+//A few hand picked groups, including zero weights, and a larger pseudo random one
+void buildTestGroups(std::vector<TestGroup>& groups_out)
+{
+	groups_out.push_back(TestGroup{ "Uneven", 1.0f, { 1.0f, 2.0f, 3.0f, 4.0f, 0.0f } });
+	groups_out.push_back(TestGroup{ "Heavy", 3.0f, { 0.5f, 0.5f, 5.0f } });
+	groups_out.push_back(TestGroup{ "Disabled", 0.0f, { 1.0f, 1.0f } });
+	groups_out.push_back(TestGroup{ "Single", 0.25f, { 2.0f } });
+
+	TestGroup random_group{ "Random", 1.5f, {} };
+	for (unsigned int i = 0u; i < 200u; i++)
+		random_group.outfitWeights.push_back(static_cast<float>(mixSeed(DrawSeed, i) % 1000u) / 100.0f + 0.01f);
+	groups_out.push_back(random_group);
+}
+
+//Every outfit gets a form of its own, so registering a new one isn't a duplicate
+void writeGroupFiles(const std::string& dir, const std::vector<TestGroup>& groups, FakeFormResolver& resolver)
+{
+	FormID local_form_id = TestFirstLocalFormID;
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+
+	for (const TestGroup& group : groups) {
+		Json::Value group_json;
+		group_json["weight"] = group.weight;
+		for (unsigned int i = 0u; i < group.outfitWeights.size(); i++) {
+			resolver.addForm(TestModName, local_form_id);
+			group_json["outfits"][getTestOutfitName(i)].append(FakeFormResolver::formReference(TestModName, local_form_id++));
+			group_json["weights"][getTestOutfitName(i)] = group.outfitWeights[i];
+		}
+
+		std::ofstream group_file(dir + "/" + group.name + ".json");
+		Json::FastWriter writer;
+		group_file << writer.write(group_json);
+	}
+}
+
+//Wilson-Hilferty approximation of the chi-square quantile
+double getCriticalValue(unsigned int degrees)
+{
+	double k = static_cast<double>(degrees);
+	double term = 1.0 - 2.0 / (9.0 * k) + CriticalZ * std::sqrt(2.0 / (9.0 * k));
+	return k * term * term * term;
+}
+
+//Draws from the group's table (the catalog table for an empty name) and compares against expected_weights by outfit index
+bool checkDistribution(const OutfitCatalog& catalog, const std::string& group_name, const std::vector<double>& expected_weights, unsigned int draws)
+{
+	std::vector<unsigned int> observed(catalog.outfits.size(), 0u);
+	for (unsigned int i = 0u; i < draws; i++) {
+		int index = getWeightedOutfitIndex(catalog, group_name, static_cast<int>(i), static_cast<int>(DrawSeed));
+		if (index < 0 || static_cast<unsigned int>(index) >= observed.size()) {
+			std::cerr << "Draw " << i << " from " << group_name << " returned " << index << std::endl;
+			return false;
+		}
+		observed[index]++;
+	}
+
+	double total_weight = 0.0;
+	for (double weight : expected_weights)
+		total_weight += weight;
+
+	double chi_square = 0.0;
+	unsigned int categories = 0u;
+	for (unsigned int i = 0u; i < observed.size(); i++) {
+		if (expected_weights[i] <= 0.0) {
+			if (observed[i] > 0u) {
+				std::cerr << "Outfit " << i << " without weight was drawn " << observed[i] << " times from " << group_name << std::endl;
+				return false;
+			}
+			continue;
+		}
+
+		double expected = draws * expected_weights[i] / total_weight;
+		chi_square += (observed[i] - expected) * (observed[i] - expected) / expected;
+		categories++;
+	}
+
+	//One outfit is always drawn, nothing to test
+	if (categories < 2u)
+		return true;
+
+	double critical = getCriticalValue(categories - 1u);
+	std::cerr << (group_name.empty() ? "catalog" : group_name) << ": chi-square " << chi_square << ", critical " << critical << ", " << categories << " outfits" << std::endl;
+	return chi_square <= critical;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int draws = argc > 1 ? static_cast<unsigned int>(std::strtoul(argv[1], NULL, 10)) : DefaultDraws;
+
+	spdlog::set_default_logger(spdlog::stderr_color_mt("test"));
+	spdlog::set_level(spdlog::level::warn);
+
+	FakeFormResolver resolver;
+	SetFormResolver(&resolver);
+
+	std::string dir = (std::filesystem::temp_directory_path() / "OutfitPlaylistAliasTest").string();
+	std::vector<TestGroup> groups;
+	buildTestGroups(groups);
+	writeGroupFiles(dir, groups, resolver);
+	LoadCatalog(dir, Json::Value());
+	CatalogPtr catalog = getCatalog();
+
+	bool passed = true;
+	std::vector<double> catalog_weights(catalog->outfits.size(), 0.0);
+	for (const TestGroup& group : groups) {
+		std::vector<double> group_weights(catalog->outfits.size(), 0.0);
+		for (unsigned int i = 0u; i < group.outfitWeights.size(); i++) {
+			int index = getOutfitIndex(*catalog, group.name, getTestOutfitName(i));
+			if (index < 0) {
+				std::cerr << "Outfit not loaded " << group.name << ":" << getTestOutfitName(i) << std::endl;
+				return 1;
+			}
+			group_weights[index] = group.outfitWeights[i];
+			catalog_weights[index] = static_cast<double>(group.outfitWeights[i]) * group.weight;
+		}
+
+		if (!checkDistribution(*catalog, group.name, group_weights, draws))
+			passed = false;
+	}
+
+	if (!checkDistribution(*catalog, std::string(), catalog_weights, draws))
+		passed = false;
+
+	//Registering rebuilds the touched group's table and the catalog table
+	Outfit registered;
+	registered.name = "Registered";
+	registered.weight = 6.0f;
+	registered.forms.push_back(resolver.addForm(TestModName, TestFirstLocalFormID - 1u));
+	unsigned int registered_index;
+	if (!registerOutfit(registered, "Uneven", registered_index)) {
+		std::cerr << "Unable to register an outfit" << std::endl;
+		return 1;
+	}
+
+	catalog = getCatalog();
+	catalog_weights.resize(catalog->outfits.size(), 0.0);
+	catalog_weights[registered_index] = 6.0;
+	if (!checkDistribution(*catalog, std::string(), catalog_weights, draws))
+		passed = false;
+
+	std::vector<double> uneven_weights(catalog->outfits.size(), 0.0);
+	for (unsigned int index : catalog->groups.at("Uneven").outfitIndices)
+		uneven_weights[index] = catalog_weights[index]; //The group weight is 1
+	if (!checkDistribution(*catalog, "Uneven", uneven_weights, draws))
+		passed = false;
+
+	std::filesystem::remove_all(dir);
+	std::cerr << (passed ? "Passed" : "Failed") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#include "core/Catalog.h"
+#include "core/GroupWatcher.h"
+#include "core/fake/FakeGameData.h"
+
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+//Checks that the polling watcher reports changed, added and removed group files and that
+//applying them reloads the catalog with stable indices. Exits with 1 on failure.
+//Usage: OutfitPlaylistWatcherTest
+
+using namespace OutfitPlaylist;
+
+const std::chrono::milliseconds PollInterval(50);
+const std::chrono::milliseconds ChangeTimeout(5000);
+
+std::mutex sChangeMutex;
+std::condition_variable sChangeWake;
+unsigned int sChangeNotifications = 0u;
+
+//Written aside and renamed into place, so a poll never sees a half written file
+void writeGroupFile(const std::string& dir, const std::string& group_name, const std::vector<std::string>& outfit_names)
+{
+	Json::Value group_json;
+	group_json["outfits"] = Json::Value(Json::objectValue);
+	for (const std::string& outfit_name : outfit_names)
+		group_json["outfits"][outfit_name] = Json::Value(Json::arrayValue);
+
+	std::string path = dir + "/" + group_name + ".json";
+	{
+		std::ofstream group_file(path + ".tmp");
+		Json::FastWriter writer;
+		group_file << writer.write(group_json);
+	}
+	std::filesystem::rename(path + ".tmp", path);
+}
+
+//Waits for the watcher's next notification and applies the pending changes like the plugin does
+bool waitForReload(GroupFileChanges& changes_out)
+{
+	std::unique_lock<std::mutex> lock(sChangeMutex);
+	if (!sChangeWake.wait_for(lock, ChangeTimeout, []() { return sChangeNotifications > 0u; }))
+		return false;
+	sChangeNotifications = 0u;
+	lock.unlock();
+
+	if (!takeGroupFileChanges(changes_out))
+		return false;
+	ReloadGroupFiles(changes_out);
+	return true;
+}
+
+bool check(bool condition, const char* message)
+{
+	if (!condition)
+		std::cerr << "Failed: " << message << std::endl;
+	return condition;
+}
+
+int main()
+{
+	spdlog::set_default_logger(spdlog::stderr_color_mt("test"));
+	spdlog::set_level(spdlog::level::warn);
+
+	FakeFormResolver resolver;
+	SetFormResolver(&resolver);
+
+	std::string dir = (std::filesystem::temp_directory_path() / "OutfitPlaylistWatcherTest").string();
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+
+	writeGroupFile(dir, "Casual", { "Red", "Blue" });
+	writeGroupFile(dir, "Formal", { "Suit" });
+	LoadCatalog(dir, Json::Value());
+	int blue_index = getOutfitIndex(*getCatalog(), "Casual", "Blue");
+
+	StartGroupWatcher(dir, PollInterval, []() {
+		{
+			std::lock_guard<std::mutex> lock(sChangeMutex);
+			sChangeNotifications++;
+		}
+		sChangeWake.notify_all();
+	});
+
+	bool passed = true;
+	GroupFileChanges changes;
+
+	//Changed
+	writeGroupFile(dir, "Casual", { "Red", "Blue", "Green" });
+	passed &= check(waitForReload(changes), "no reload after a group file changed");
+	passed &= check(changes.changed.size() == 1u && changes.changed[0] == "Casual.json", "changed file not reported");
+	passed &= check(getOutfitIndex(*getCatalog(), "Casual", "Green") >= 0, "outfit added by the change not loaded");
+	passed &= check(getOutfitIndex(*getCatalog(), "Casual", "Blue") == blue_index, "unchanged outfit moved");
+
+	//Added
+	writeGroupFile(dir, "Armor", { "Iron" });
+	passed &= check(waitForReload(changes), "no reload after a group file was added");
+	passed &= check(changes.changed.size() == 1u && changes.changed[0] == "Armor.json", "added file not reported");
+	passed &= check(getOutfitIndex(*getCatalog(), "Armor", "Iron") >= 0, "added group not loaded");
+
+	//Removed
+	std::filesystem::remove(dir + "/Formal.json");
+	passed &= check(waitForReload(changes), "no reload after a group file was removed");
+	passed &= check(changes.removed.size() == 1u && changes.removed[0] == "Formal.json", "removed file not reported");
+	passed &= check(getOutfitIndex(*getCatalog(), "Formal", "Suit") < 0, "removed group still loaded");
+	passed &= check(getOutfitIndex(*getCatalog(), "Casual", "Blue") == blue_index, "outfit moved by another group's removal");
+
+	//Our own writes aren't changes
+	saveGroupFile(*getCatalog(), getCatalog()->groups.at("Casual"));
+	{
+		std::unique_lock<std::mutex> lock(sChangeMutex);
+		passed &= check(!sChangeWake.wait_for(lock, PollInterval * 4, []() { return sChangeNotifications > 0u; }), "saved group file reported as a change");
+	}
+
+	//Nothing is reported once stopped, the thread is joined
+	StopGroupWatcher();
+	writeGroupFile(dir, "Late", { "Cloak" });
+	{
+		std::unique_lock<std::mutex> lock(sChangeMutex);
+		passed &= check(!sChangeWake.wait_for(lock, PollInterval * 4, []() { return sChangeNotifications > 0u; }), "change reported after the watcher stopped");
+	}
+
+	std::filesystem::remove_all(dir);
+	std::cerr << (passed ? "Passed" : "Failed") << std::endl;
+	return passed ? 0 : 1;
+}
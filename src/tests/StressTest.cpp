@@ -0,0 +1,265 @@
+#include "core/ActorState.h"
+#include "core/Catalog.h"
+#include "core/CoreUtil.h"
+#include "core/fake/FakeGameData.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+//Concurrent readers against catalog and actor state writers. Readers check every snapshot they
+//get for consistency and every index they get back for liveness. Exits with 1 on failure.
+//Usage: OutfitPlaylistStressTest [milliseconds] [reader threads]
+
+using namespace OutfitPlaylist;
+
+const unsigned int DefaultDurationMs = 2000u;
+const unsigned int DefaultReaders = 4u;
+const unsigned int FixedOutfits = 20u;
+const unsigned int ChurnOutfits = 10u;
+const unsigned int RegisterForms = 4096u; //One per registered outfit, forms can't be added once threads run
+const unsigned int StressActors = 64u;
+const std::string StressModName = "Stress.esp";
+const FormID StressFirstLocalFormID = 0x800u;
+const FormID StressFirstActorID = 0xFF000800u;
+const unsigned int MaxReportedFailures = 10u;
+
+std::atomic<bool> sStopping(false);
+std::atomic<unsigned int> sFailures(0u);
+std::atomic<std::uint64_t> sReads(0u);
+std::atomic<std::uint64_t> sWrites(0u);
+std::mutex sReportMutex;
+
+void fail(const std::string& message)
+{
+	if (sFailures.fetch_add(1u) < MaxReportedFailures) {
+		std::lock_guard<std::mutex> lock(sReportMutex);
+		std::cerr << "Failed: " << message << std::endl;
+	}
+}
+
+std::string getStressOutfitName(unsigned int outfit)
+{
+	return "Outfit" + std::to_string(outfit);
+}
+
+void writeGroupFile(const std::string& dir, const std::string& group_name, unsigned int outfits, FormID first_local_form_id)
+{
+	Json::Value group_json;
+	for (unsigned int i = 0u; i < outfits; i++)
+		group_json["outfits"][getStressOutfitName(i)].append(FakeFormResolver::formReference(StressModName, first_local_form_id + i));
+
+	std::ofstream group_file(dir + "/" + group_name + ".json");
+	Json::FastWriter writer;
+	group_file << writer.write(group_json);
+}
+
+bool isLiveIndex(const OutfitCatalog& catalog, int index)
+{
+	return index >= 0 && static_cast<unsigned int>(index) < catalog.outfits.size() && !catalog.outfits[index].groupName.empty();
+}
+
+//A torn catalog would show up as a group, id or live index pointing at the wrong outfit
+void checkSnapshot(const OutfitCatalog& catalog)
+{
+	for (unsigned int index : catalog.liveIndices) {
+		if (!isLiveIndex(catalog, static_cast<int>(index)))
+			fail(fmt::format("catalog {} lists dead outfit {} as live", catalog.version, index));
+	}
+
+	for (OutfitGroupMap::const_iterator it = catalog.groups.begin(); it != catalog.groups.end(); ++it) {
+		for (unsigned int index : it->second.outfitIndices) {
+			if (index >= catalog.outfits.size() || catalog.outfits[index].groupName != it->first)
+				fail(fmt::format("catalog {} group {} holds outfit {} of another group", catalog.version, it->first, index));
+		}
+		for (unsigned int index : it->second.aliasTable.outfitIndices) {
+			if (!isLiveIndex(catalog, static_cast<int>(index)))
+				fail(fmt::format("catalog {} group {} alias table holds dead outfit {}", catalog.version, it->first, index));
+		}
+	}
+
+	for (OutfitIDMap::const_iterator it = catalog.idIndices.begin(); it != catalog.idIndices.end(); ++it) {
+		if (!isLiveIndex(catalog, static_cast<int>(it->second)) || catalog.outfits[it->second].id != it->first)
+			fail(fmt::format("catalog {} id {} maps to outfit {} with another id", catalog.version, outfitIDToString(it->first), it->second));
+	}
+
+	for (unsigned int index : catalog.aliasTable.outfitIndices) {
+		if (!isLiveIndex(catalog, static_cast<int>(index)))
+			fail(fmt::format("catalog {} alias table holds dead outfit {}", catalog.version, index));
+	}
+}
+
+void runReader(unsigned int reader)
+{
+	unsigned int last_version = 0u;
+	for (unsigned int i = 0u; !sStopping.load(std::memory_order_relaxed); i++) {
+		CatalogPtr catalog = getCatalog();
+		if (catalog->version < last_version)
+			fail(fmt::format("reader {} saw catalog {} after {}", reader, catalog->version, last_version));
+		last_version = catalog->version;
+
+		//The whole snapshot is cheap enough to check every few reads
+		if (i % 16u == 0u)
+			checkSnapshot(*catalog);
+
+		std::string fixed_name = getStressOutfitName(i % FixedOutfits);
+		int fixed_index = getOutfitIndex(*catalog, "Fixed", fixed_name);
+		if (!isLiveIndex(*catalog, fixed_index) || catalog->outfits[fixed_index].name != fixed_name)
+			fail(fmt::format("Fixed:{} resolved to {} in catalog {}", fixed_name, fixed_index, catalog->version));
+
+		int churn_index = getOutfitIndex(*catalog, "Churn", getStressOutfitName(i % ChurnOutfits));
+		if (churn_index >= 0 && !isLiveIndex(*catalog, churn_index))
+			fail(fmt::format("Churn outfit resolved to dead outfit {} in catalog {}", churn_index, catalog->version));
+
+		int seed = static_cast<int>(i % 3u) - 1; //Catalog order and two shuffles
+		int shuffled_index = getShuffledOutfitIndex(*catalog, static_cast<int>(i), seed);
+		if (!isLiveIndex(*catalog, shuffled_index))
+			fail(fmt::format("shuffle position {} seed {} returned dead outfit {} in catalog {}", i, seed, shuffled_index, catalog->version));
+
+		ActorOutfitInfo info;
+		FormID actor_id = StressFirstActorID + (i + reader) % StressActors;
+		if (getActorOutfitInfo(actor_id, info)) {
+			//The info comes from whichever catalog was current, slots are never removed
+			if (info.name.empty() || info.groupName.empty())
+				fail(fmt::format("actor {} outfit info without a name", formIDToString(actor_id)));
+			if (info.index >= 0 && static_cast<unsigned int>(info.index) >= getCatalog()->outfits.size())
+				fail(fmt::format("actor {} outfit info index {} is out of range", formIDToString(actor_id), info.index));
+		}
+
+		sReads.fetch_add(1u, std::memory_order_relaxed);
+	}
+}
+
+void runRegisterWriter(const FormVec& forms)
+{
+	for (unsigned int i = 0u; i < forms.size() && !sStopping.load(std::memory_order_relaxed); i++) {
+		Outfit outfit;
+		outfit.name = "Registered";
+		outfit.forms.push_back(forms[i]);
+		unsigned int index;
+		if (!registerOutfit(outfit, "Registered", index))
+			fail(fmt::format("registering outfit {} failed", i));
+		else if (!isLiveIndex(*getCatalog(), static_cast<int>(index)))
+			fail(fmt::format("registered outfit {} isn't live", index));
+		sWrites.fetch_add(1u, std::memory_order_relaxed);
+	}
+}
+
+void runRenameWriter()
+{
+	std::string name = getStressOutfitName(0u);
+	for (unsigned int i = 0u; !sStopping.load(std::memory_order_relaxed); i++) {
+		int index = renameOutfit("Renamed", name, "Renamed" + std::to_string(i));
+		if (index < 0) {
+			fail(fmt::format("renaming {} failed", name));
+			return;
+		}
+		name = getCatalog()->outfits[index].name;
+		sWrites.fetch_add(1u, std::memory_order_relaxed);
+	}
+}
+
+//Removing the churn group tombstones its outfits, adding it back reloads it
+void runReloadWriter(const std::string& dir)
+{
+	for (unsigned int i = 0u; !sStopping.load(std::memory_order_relaxed); i++) {
+		GroupFileChanges changes;
+		if (i % 2u == 0u)
+			changes.removed.push_back("Churn.json");
+		else {
+			writeGroupFile(dir, "Churn", ChurnOutfits - i % 3u, StressFirstLocalFormID + FixedOutfits);
+			changes.changed.push_back("Churn.json");
+		}
+		ReloadGroupFiles(changes);
+		sWrites.fetch_add(1u, std::memory_order_relaxed);
+	}
+}
+
+void runEquipWriter()
+{
+	for (unsigned int i = 0u; !sStopping.load(std::memory_order_relaxed); i++) {
+		FormID actor_id = StressFirstActorID + i % StressActors;
+		CatalogPtr catalog = getCatalog();
+		if (i % 5u == 4u)
+			clearActorOutfit(actor_id);
+		else if (!catalog->liveIndices.empty())
+			setActorOutfit(actor_id, catalog->liveIndices[mixSeed(1u, i) % catalog->liveIndices.size()], i % 2u == 0u);
+		sWrites.fetch_add(1u, std::memory_order_relaxed);
+	}
+}
+
+//Once the writers are done, every cached actor answer must match the actor state
+void checkActorInfo()
+{
+	CatalogPtr catalog = getCatalog();
+	for (unsigned int a = 0u; a < StressActors; a++) {
+		FormID actor_id = StressFirstActorID + a;
+		Outfit outfit;
+		ActorOutfitInfo info;
+		bool has_outfit = getActorOutfit(actor_id, outfit);
+		if (getActorOutfitInfo(actor_id, info) != has_outfit) {
+			fail(fmt::format("actor {} outfit info disagrees on having an outfit", formIDToString(actor_id)));
+			continue;
+		}
+		if (has_outfit && (info.name != outfit.name || info.groupName != outfit.groupName || info.doNotRemove != outfit.doNotRemove ||
+			info.index != getOutfitIndex(*catalog, outfit.groupName, outfit.name)))
+			fail(fmt::format("actor {} outfit info is stale", formIDToString(actor_id)));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int duration_ms = argc > 1 ? static_cast<unsigned int>(std::strtoul(argv[1], NULL, 10)) : DefaultDurationMs;
+	unsigned int readers = argc > 2 ? std::max(static_cast<unsigned int>(std::strtoul(argv[2], NULL, 10)), 1u) : DefaultReaders;
+
+	spdlog::set_default_logger(spdlog::stderr_color_mt("test"));
+	spdlog::set_level(spdlog::level::err);
+
+	FakeFormResolver resolver;
+	SetFormResolver(&resolver);
+
+	std::string dir = (std::filesystem::temp_directory_path() / "OutfitPlaylistStressTest").string();
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+
+	FormVec register_forms;
+	for (unsigned int i = 0u; i < FixedOutfits + ChurnOutfits + RegisterForms; i++) {
+		FakeForm* form = resolver.addForm(StressModName, StressFirstLocalFormID + i);
+		if (i >= FixedOutfits + ChurnOutfits)
+			register_forms.push_back(form);
+	}
+	for (unsigned int a = 0u; a < StressActors; a++)
+		resolver.addActor(StressFirstActorID + a);
+
+	writeGroupFile(dir, "Fixed", FixedOutfits, StressFirstLocalFormID);
+	writeGroupFile(dir, "Renamed", 1u, StressFirstLocalFormID);
+	writeGroupFile(dir, "Churn", ChurnOutfits, StressFirstLocalFormID + FixedOutfits);
+	LoadCatalog(dir, Json::Value());
+
+	std::vector<std::thread> threads;
+	for (unsigned int r = 0u; r < readers; r++)
+		threads.emplace_back(runReader, r);
+	threads.emplace_back(runRegisterWriter, std::cref(register_forms));
+	threads.emplace_back(runRenameWriter);
+	threads.emplace_back(runReloadWriter, std::cref(dir));
+	threads.emplace_back(runEquipWriter);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+	sStopping.store(true);
+	for (std::thread& thread : threads)
+		thread.join();
+
+	checkSnapshot(*getCatalog());
+	checkActorInfo();
+
+	std::filesystem::remove_all(dir);
+	std::cerr << sReads.load() << " reads, " << sWrites.load() << " writes, catalog version " << getCatalog()->version << ", " << sFailures.load() << " failures" << std::endl;
+	return sFailures.load() == 0u ? 0 : 1;
+}